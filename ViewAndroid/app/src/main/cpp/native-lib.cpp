@@ -16,7 +16,7 @@ Java_com_iwatake_viewandroidncnn_MainActivity_ImageProcessorInitialize(
 
     std::lock_guard<std::mutex> lock(g_mtx);
     int ret = 0;
-    ImageProcessor::InputParam input_param = { WORK_DIR, 4 };
+    ImageProcessor::InputParam input_param = { WORK_DIR, 4, 2 };
     ret = ImageProcessor::Initialize(input_param);
     return ret;
 }
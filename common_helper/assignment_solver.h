@@ -0,0 +1,130 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef ASSIGNMENT_SOLVER_
+#define ASSIGNMENT_SOLVER_
+
+#include <cstdint>
+#include <vector>
+#include <limits>
+#include <algorithm>
+
+
+/* Calculate assignment to minimize cost using shortest augmenting path (Jonker-Volgenant style Hungarian method with potentials) */
+/* O(n^2 * m) for n x m (n <= m) cost matrix. Rectangular matrix is supported without padding */
+/* Work buffers are kept in the object, so reuse the same object to avoid allocation */
+template<typename T>
+class AssignmentSolver
+{
+public:
+    AssignmentSolver() {}
+    ~AssignmentSolver() {}
+
+    /* cost_matrix: row major contiguous (rows x cols) */
+    /* assign_for_row[y] = x, assign_for_col[x] = y. -1 for not assigned. min(rows, cols) pairs are assigned */
+    void Solve(const T* cost_matrix, int32_t rows, int32_t cols, std::vector<int32_t>& assign_for_row, std::vector<int32_t>& assign_for_col)
+    {
+        assign_for_row.assign(rows, -1);
+        assign_for_col.assign(cols, -1);
+        if (rows == 0 || cols == 0) return;
+
+        /* Always solve n <= m. Use the transposed matrix when rows > cols */
+        if (rows <= cols) {
+            SolveImpl(cost_matrix, rows, cols, cols, 1, assign_for_row, assign_for_col);
+        } else {
+            SolveImpl(cost_matrix, cols, rows, 1, cols, assign_for_col, assign_for_row);
+        }
+    }
+
+    void Solve(const std::vector<T>& cost_matrix, int32_t rows, int32_t cols, std::vector<int32_t>& assign_for_row, std::vector<int32_t>& assign_for_col)
+    {
+        Solve(cost_matrix.data(), rows, cols, assign_for_row, assign_for_col);
+    }
+
+private:
+    /* cost(i, j) = cost_matrix[i * stride_i + j * stride_j], n <= m */
+    void SolveImpl(const T* cost_matrix, int32_t n, int32_t m, int32_t stride_i, int32_t stride_j, std::vector<int32_t>& assign_for_i, std::vector<int32_t>& assign_for_j)
+    {
+        const T kInf = std::numeric_limits<T>::has_infinity ? std::numeric_limits<T>::infinity() : (std::numeric_limits<T>::max)();
+
+        /* Index 0 is a virtual column used as the start of each augmenting path */
+        u_.assign(n + 1, 0);
+        v_.assign(m + 1, 0);
+        match_.assign(m + 1, 0);    /* match_[j] = i (1-origin, 0 = not assigned) */
+        way_.assign(m + 1, 0);
+        min_v_.resize(m + 1);
+        used_.resize(m + 1);
+
+        for (int32_t i = 1; i <= n; i++) {
+            match_[0] = i;
+            int32_t j0 = 0;
+            std::fill(min_v_.begin(), min_v_.end(), kInf);
+            std::fill(used_.begin(), used_.end(), 0);
+
+            /* Dijkstra-like search for the shortest augmenting path from row i */
+            do {
+                used_[j0] = 1;
+                const int32_t i0 = match_[j0];
+                const T* cost_row = cost_matrix + (i0 - 1) * stride_i;
+                T delta = kInf;
+                int32_t j1 = 0;
+                for (int32_t j = 1; j <= m; j++) {
+                    if (used_[j]) continue;
+                    const T cur = cost_row[(j - 1) * stride_j] - u_[i0] - v_[j];
+                    if (cur < min_v_[j]) {
+                        min_v_[j] = cur;
+                        way_[j] = j0;
+                    }
+                    if (min_v_[j] < delta) {
+                        delta = min_v_[j];
+                        j1 = j;
+                    }
+                }
+                for (int32_t j = 0; j <= m; j++) {
+                    if (used_[j]) {
+                        u_[match_[j]] += delta;
+                        v_[j] -= delta;
+                    } else {
+                        min_v_[j] -= delta;
+                    }
+                }
+                j0 = j1;
+            } while (match_[j0] != 0);
+
+            /* Flip the path */
+            do {
+                const int32_t j1 = way_[j0];
+                match_[j0] = match_[j1];
+                j0 = j1;
+            } while (j0 != 0);
+        }
+
+        for (int32_t j = 1; j <= m; j++) {
+            if (match_[j] != 0) {
+                assign_for_i[match_[j] - 1] = j - 1;
+                assign_for_j[j - 1] = match_[j] - 1;
+            }
+        }
+    }
+
+private:
+    std::vector<T> u_;              /* potential for row */
+    std::vector<T> v_;              /* potential for column */
+    std::vector<T> min_v_;          /* minimum reduced cost to each column in the current search */
+    std::vector<int32_t> match_;
+    std::vector<int32_t> way_;
+    std::vector<uint8_t> used_;
+};
+
+#endif
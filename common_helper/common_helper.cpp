@@ -21,9 +21,13 @@ limitations under the License.
 #include <array>
 #include <algorithm>
 #include <chrono>
+#include <functional>
 
 #include "common_helper.h"
 
+#define TAG "CommonHelper"
+#define PRINT(...)   COMMON_HELPER_PRINT(TAG, __VA_ARGS__)
+
 float CommonHelper::Sigmoid(float x)
 {
     if (x >= 0) {
@@ -72,4 +76,25 @@ float CommonHelper::SoftMaxFast(const float* src, float* dst, int32_t length)
     return 0;
 }
 
-
+bool CommonHelper::Warmup(int32_t num, const std::function<bool()>& process)
+{
+    double time_cold = 0;
+    double time_warm = 0;
+    for (int32_t i = 0; i < num; i++) {
+        const auto& t0 = std::chrono::steady_clock::now();
+        if (!process()) return false;
+        const auto& t1 = std::chrono::steady_clock::now();
+        double time = static_cast<std::chrono::duration<double>>(t1 - t0).count() * 1000.0;
+        if (i == 0) {
+            time_cold = time;
+        } else {
+            time_warm += time;
+        }
+    }
+    if (num > 1) {
+        PRINT("Warm-up: cold = %.3f [msec], warm = %.3f [msec] (average of %d)\n", time_cold, time_warm / (num - 1), num - 1);
+    } else if (num == 1) {
+        PRINT("Warm-up: cold = %.3f [msec]\n", time_cold);
+    }
+    return true;
+}
@@ -21,6 +21,7 @@ limitations under the License.
 #include <string>
 #include <vector>
 #include <array>
+#include <functional>
 
 
 #if defined(ANDROID) || defined(__ANDROID__)
@@ -48,6 +49,9 @@ namespace CommonHelper
 float Sigmoid(float x);
 float Logit(float x);
 float SoftMaxFast(const float* src, float* dst, int32_t length);
+/* Call process num times. The time of the first call (cold) and the average of the rest (warm) are printed. Return false when process fails */
+/* Engines call it at the end of Initialize with their own Process and a blank image, so that the first real frame doesn't pay for lazy allocation in the inference engine and pre-process */
+bool Warmup(int32_t num, const std::function<bool()>& process);
 
 }
 
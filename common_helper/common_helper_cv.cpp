@@ -112,6 +112,45 @@ void CommonHelper::CropResizeCvt(const cv::Mat& org, cv::Mat& dst, int32_t& crop
 
 }
 
+void CommonHelper::CropResizeCvtMosaic(const cv::Mat& org, cv::Mat& dst, const std::vector<cv::Rect>& roi_list, std::vector<MosaicTile>& tile_list, bool is_rgb, bool resize_by_linear)
+{
+    tile_list.clear();
+    if (roi_list.empty()) return;
+
+    /* Tile layout: cols x rows grid (e.g. 2 ROIs: 2x1, 4 ROIs: 2x2, 5 ROIs: 3x2) */
+    const int32_t num = static_cast<int32_t>(roi_list.size());
+    const int32_t cols = static_cast<int32_t>(std::ceil(std::sqrt(static_cast<float>(num))));
+    const int32_t rows = (num + cols - 1) / cols;
+    const int32_t tile_w = dst.cols / cols;
+    const int32_t tile_h = dst.rows / rows;
+    const cv::Rect image_rect(0, 0, org.cols, org.rows);
+
+    for (int32_t i = 0; i < num; i++) {
+        MosaicTile mosaic_tile;
+        mosaic_tile.tile = cv::Rect((i % cols) * tile_w, (i / cols) * tile_h, tile_w, tile_h);
+        cv::Rect roi = roi_list[i] & image_rect;
+        if (roi.width <= 0 || roi.height <= 0) {
+            roi = image_rect;
+        }
+        cv::Mat dst_tile = dst(mosaic_tile.tile);
+        int32_t crop_x = roi.x;
+        int32_t crop_y = roi.y;
+        int32_t crop_w = roi.width;
+        int32_t crop_h = roi.height;
+        CropResizeCvt(org, dst_tile, crop_x, crop_y, crop_w, crop_h, is_rgb, kCropTypeExpand, resize_by_linear);
+        mosaic_tile.crop = cv::Rect(crop_x, crop_y, crop_w, crop_h);
+        tile_list.push_back(mosaic_tile);
+    }
+}
+
+int32_t CommonHelper::FindMosaicTile(const std::vector<MosaicTile>& tile_list, int32_t x, int32_t y)
+{
+    for (int32_t i = 0; i < static_cast<int32_t>(tile_list.size()); i++) {
+        if (tile_list[i].tile.contains(cv::Point(x, y))) return i;
+    }
+    return -1;
+}
+
 /* https://github.com/JetsonHacksNano/CSI-Camera/blob/master/simple_camera.cpp */
 /* modified by iwatake2222 */
 std::string CommonHelper::CreateGStreamerPipeline(int capture_width, int capture_height, int display_width, int display_height, int framerate, int flip_method) {
@@ -37,6 +37,15 @@ enum {
 cv::Scalar CreateCvColor(int32_t b, int32_t g, int32_t r);
 void DrawText(cv::Mat& mat, const std::string& text, cv::Point pos, double font_scale, int32_t thickness, cv::Scalar color_front, cv::Scalar color_back, bool is_text_on_rect = true);
 void CropResizeCvt(const cv::Mat& org, cv::Mat& dst, int32_t& crop_x, int32_t& crop_y, int32_t& crop_w, int32_t& crop_h, bool is_rgb = true, int32_t crop_type = kCropTypeStretch, bool resize_by_linear = true);
+
+/* Pack several regions of org into one image (dst) as tiles. Each region keeps its aspect ratio in the tile (kCropTypeExpand) */
+/* tile: area in dst, crop: area in org which corresponds to the whole tile */
+typedef struct {
+    cv::Rect tile;
+    cv::Rect crop;
+} MosaicTile;
+void CropResizeCvtMosaic(const cv::Mat& org, cv::Mat& dst, const std::vector<cv::Rect>& roi_list, std::vector<MosaicTile>& tile_list, bool is_rgb = true, bool resize_by_linear = true);
+int32_t FindMosaicTile(const std::vector<MosaicTile>& tile_list, int32_t x, int32_t y);    /* index of the tile which contains (x, y) in dst. -1 if not found */
 std::string CreateGStreamerPipeline(int capture_width, int capture_height, int display_width, int display_height, int framerate, int flip_method);
 bool FindSourceImage(const std::string& input_name, cv::VideoCapture& cap, int32_t width = 640, int32_t height = 480);
 bool InputKeyCommand(cv::VideoCapture& cap);
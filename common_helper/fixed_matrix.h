@@ -0,0 +1,140 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef FIXED_MATRIX_
+#define FIXED_MATRIX_
+
+#include <cstdint>
+#include <initializer_list>
+
+/* Matrix whose shape is decided at compile time. Data is held in the object itself (no heap allocation), and shape is checked by the compiler */
+template<int32_t ROWS, int32_t COLS>
+class FixedMatrix
+{
+public:
+    static constexpr int32_t rows = ROWS;
+    static constexpr int32_t cols = COLS;
+
+    FixedMatrix()
+    {
+        SetZero();
+    }
+
+    FixedMatrix(std::initializer_list<double> data_list)
+    {
+        SetZero();
+        int32_t i = 0;
+        for (const auto& val : data_list) {
+            if (i >= ROWS * COLS) break;
+            data_array[i++] = val;
+        }
+    }
+
+    double& operator() (int32_t y, int32_t x) { return data_array[y * COLS + x]; }
+    const double& operator() (int32_t y, int32_t x) const { return data_array[y * COLS + x]; }
+
+    void SetZero()
+    {
+        for (int32_t i = 0; i < ROWS * COLS; i++) data_array[i] = 0;
+    }
+
+    FixedMatrix<COLS, ROWS> Transpose() const
+    {
+        FixedMatrix<COLS, ROWS> ret;
+        for (int32_t y = 0; y < ROWS; y++) {
+            for (int32_t x = 0; x < COLS; x++) {
+                ret(x, y) = (*this)(y, x);
+            }
+        }
+        return ret;
+    }
+
+    static FixedMatrix IdentityMatrix()
+    {
+        static_assert(ROWS == COLS, "IdentityMatrix must be square");
+        FixedMatrix ret;
+        for (int32_t i = 0; i < ROWS; i++) {
+            ret(i, i) = 1;
+        }
+        return ret;
+    }
+
+    double data_array[ROWS * COLS];
+};
+
+template<int32_t ROWS, int32_t COLS>
+constexpr int32_t FixedMatrix<ROWS, COLS>::rows;
+template<int32_t ROWS, int32_t COLS>
+constexpr int32_t FixedMatrix<ROWS, COLS>::cols;
+
+
+namespace FixedMatrixUtils
+{
+    /* out = a * b */
+    template<int32_t M, int32_t K, int32_t N>
+    inline void Multiply(FixedMatrix<M, N>& out, const FixedMatrix<M, K>& a, const FixedMatrix<K, N>& b)
+    {
+        for (int32_t y = 0; y < M; y++) {
+            for (int32_t x = 0; x < N; x++) {
+                double sum = 0;
+                for (int32_t i = 0; i < K; i++) {
+                    sum += a(y, i) * b(i, x);
+                }
+                out(y, x) = sum;
+            }
+        }
+    }
+
+    /* out += a */
+    template<int32_t M, int32_t N>
+    inline void AddInPlace(FixedMatrix<M, N>& out, const FixedMatrix<M, N>& a)
+    {
+        for (int32_t i = 0; i < M * N; i++) out.data_array[i] += a.data_array[i];
+    }
+
+    /* out -= a */
+    template<int32_t M, int32_t N>
+    inline void SubInPlace(FixedMatrix<M, N>& out, const FixedMatrix<M, N>& a)
+    {
+        for (int32_t i = 0; i < M * N; i++) out.data_array[i] -= a.data_array[i];
+    }
+
+    /* Gauss-Jordan elimination (the same as SimpleMatrix::Inverse). Return false if a diagonal element becomes 0 */
+    template<int32_t N>
+    inline bool Inverse(FixedMatrix<N, N>& out, const FixedMatrix<N, N>& in)
+    {
+        FixedMatrix<N, N> mat = in;
+        out = FixedMatrix<N, N>::IdentityMatrix();
+        for (int32_t y = 0; y < N; y++) {
+            if (mat(y, y) == 0) return false;
+            double scale_to_1 = 1.0 / mat(y, y);
+            for (int32_t x = 0; x < N; x++) {
+                mat(y, x) *= scale_to_1;
+                out(y, x) *= scale_to_1;
+            }
+            for (int32_t yy = 0; yy < N; yy++) {
+                if (yy != y) {
+                    double scale_to_0 = mat(yy, y);
+                    for (int32_t x = 0; x < N; x++) {
+                        mat(yy, x) -= mat(y, x) * scale_to_0;
+                        out(yy, x) -= out(y, x) * scale_to_0;
+                    }
+                }
+            }
+        }
+        return true;
+    }
+}
+
+#endif
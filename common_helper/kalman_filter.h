@@ -18,6 +18,7 @@ limitations under the License.
 #include <cstdint>
 #include <string>
 #include <vector>
+#include <utility>
 
 #include "simple_matrix.h"
 
@@ -50,20 +51,37 @@ public:
 
     void Predict()
     {
-        X = F * X;
-        P = F * P * F.Transpose() + Q;
+        /* X = F * X */
+        SimpleMatrix::Multiply(work_X_, F, X);
+        std::swap(X, work_X_);
+        /* P = F * P * Ft + Q */
+        SimpleMatrix::Multiply(work_FP_, F, P);
+        SimpleMatrix::MultiplyTransposed(P, work_FP_, F);
+        P.AddInPlace(Q);
     }
 
     void Update(const SimpleMatrix& Z)
     {
-        SimpleMatrix S = (H * P) * H.Transpose() + R;
-        SimpleMatrix K = P * H.Transpose() * S.Inverse();
-        SimpleMatrix e = Z - H * X;
-        X = X + K * e;
-        P = (SimpleMatrix::IdentityMatrix(K.rows) - (K * H)) * P;
+        /* S = H * P * Ht + R */
+        SimpleMatrix::Multiply(work_HP_, H, P);
+        SimpleMatrix::MultiplyTransposed(work_S_, work_HP_, H);
+        work_S_.AddInPlace(R);
+        /* K = P * Ht * S^-1 */
+        SimpleMatrix::MultiplyTransposed(work_PHt_, P, H);
+        SimpleMatrix::Inverse(work_S_inv_, work_inverse_, work_S_);
+        SimpleMatrix::Multiply(work_K_, work_PHt_, work_S_inv_);
+        /* e = Z - H * X */
+        SimpleMatrix::Multiply(work_HX_, H, X);
+        work_e_ = Z;
+        work_e_.SubInPlace(work_HX_);
+        /* X = X + K * e */
+        SimpleMatrix::Multiply(work_X_, work_K_, work_e_);
+        X.AddInPlace(work_X_);
+        /* P = (I - K * H) * P = P - K * (H * P) */
+        SimpleMatrix::Multiply(work_KHP_, work_K_, work_HP_);
+        P.SubInPlace(work_KHP_);
     }
 
-
 public:
     double sigma_true;
     double sigma_observe;
@@ -84,6 +102,19 @@ public:
     SimpleMatrix X;
     SimpleMatrix P;
 
+private:
+    /* Work buffers to avoid allocation at each Predict and Update */
+    SimpleMatrix work_X_;
+    SimpleMatrix work_FP_;
+    SimpleMatrix work_HP_;
+    SimpleMatrix work_PHt_;
+    SimpleMatrix work_S_;
+    SimpleMatrix work_S_inv_;
+    SimpleMatrix work_inverse_;
+    SimpleMatrix work_K_;
+    SimpleMatrix work_HX_;
+    SimpleMatrix work_e_;
+    SimpleMatrix work_KHP_;
 };
 
 
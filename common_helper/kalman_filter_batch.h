@@ -0,0 +1,348 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef KALMAN_FILTER_BATCH_H_
+#define KALMAN_FILTER_BATCH_H_
+
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+#include "fixed_matrix.h"
+#include "kalman_filter_fixed.h"
+
+/* Kalman filters for many objects sharing the same F, Q, H and R */
+/* Status (X, P) is held in structure of arrays: element i of object n is at [i * capacity + n], so Predict for all objects is vectorized */
+/* Update gathers the observed objects into blocks, and is vectorized in the same way */
+/* The calculation order is the same as KalmanFilterFixed */
+template<int32_t NUM_STATUS, int32_t NUM_OBSERVE>
+class KalmanFilterBatch {
+public:
+    typedef KalmanFilterFixed<NUM_STATUS, NUM_OBSERVE> KalmanFilter;
+    typedef typename KalmanFilter::MatrixStatus        MatrixStatus;
+    typedef typename KalmanFilter::VectorStatus        VectorStatus;
+    typedef typename KalmanFilter::MatrixObserve       MatrixObserve;
+    typedef typename KalmanFilter::VectorObserve       VectorObserve;
+    typedef typename KalmanFilter::MatrixObserveStatus MatrixObserveStatus;
+    typedef typename KalmanFilter::MatrixStatusObserve MatrixStatusObserve;
+
+private:
+    static constexpr int32_t kBlockSize = 16;   /* number of objects processed at once in Predict and Update */
+
+public:
+    KalmanFilterBatch() : capacity_(0) {}
+    ~KalmanFilterBatch() {}
+
+    void Initialize(
+        const MatrixStatus& _F,
+        const MatrixStatus& _Q,
+        const MatrixObserveStatus& _H,
+        const MatrixObserve& _R
+    )
+    {
+        F = _F;
+        Q = _Q;
+        H = _H;
+        R = _R;
+        H_t = H.Transpose();
+    }
+
+    /* Extend the number of objects. Existing status is kept */
+    void Reserve(int32_t capacity)
+    {
+        if (capacity <= capacity_) return;
+        int32_t capacity_new = (std::max)(capacity, capacity_ * 2);
+        std::vector<double> X_new(NUM_STATUS * capacity_new, 0);
+        std::vector<double> P_new(NUM_STATUS * NUM_STATUS * capacity_new, 0);
+        for (int32_t i = 0; i < NUM_STATUS; i++) {
+            std::copy(X_.begin() + i * capacity_, X_.begin() + (i + 1) * capacity_, X_new.begin() + i * capacity_new);
+        }
+        for (int32_t i = 0; i < NUM_STATUS * NUM_STATUS; i++) {
+            std::copy(P_.begin() + i * capacity_, P_.begin() + (i + 1) * capacity_, P_new.begin() + i * capacity_new);
+        }
+        X_.swap(X_new);
+        P_.swap(P_new);
+        capacity_ = capacity_new;
+    }
+
+    int32_t GetCapacity() const { return capacity_; }
+
+    void SetStatus(int32_t index, const VectorStatus& X, const MatrixStatus& P)
+    {
+        for (int32_t i = 0; i < NUM_STATUS; i++) X_[i * capacity_ + index] = X.data_array[i];
+        for (int32_t i = 0; i < NUM_STATUS * NUM_STATUS; i++) P_[i * capacity_ + index] = P.data_array[i];
+    }
+
+    void GetStatus(int32_t index, VectorStatus& X) const
+    {
+        for (int32_t i = 0; i < NUM_STATUS; i++) X.data_array[i] = X_[i * capacity_ + index];
+    }
+
+    void GetStatus(int32_t index, VectorStatus& X, MatrixStatus& P) const
+    {
+        GetStatus(index, X);
+        for (int32_t i = 0; i < NUM_STATUS * NUM_STATUS; i++) P.data_array[i] = P_[i * capacity_ + index];
+    }
+
+    /* Predict objects [0, num). Zero elements in F are skipped, so sparse F (e.g. uniform linear motion) is cheap */
+    void Predict(int32_t num)
+    {
+        double X_new[NUM_STATUS][kBlockSize];
+        double FP[NUM_STATUS * NUM_STATUS][kBlockSize];
+        for (int32_t block = 0; block < num; block += kBlockSize) {
+            const int32_t len = (std::min)(kBlockSize, num - block);
+            double* X = X_.data() + block;
+            double* P = P_.data() + block;
+
+            /* X = F * X */
+            for (int32_t y = 0; y < NUM_STATUS; y++) {
+                for (int32_t n = 0; n < len; n++) X_new[y][n] = 0;
+                for (int32_t k = 0; k < NUM_STATUS; k++) {
+                    const double f = F(y, k);
+                    if (f == 0) continue;
+                    const double* src = X + k * capacity_;
+#pragma omp simd
+                    for (int32_t n = 0; n < len; n++) X_new[y][n] += f * src[n];
+                }
+            }
+            for (int32_t y = 0; y < NUM_STATUS; y++) {
+                for (int32_t n = 0; n < len; n++) X[y * capacity_ + n] = X_new[y][n];
+            }
+
+            /* FP = F * P */
+            for (int32_t y = 0; y < NUM_STATUS; y++) {
+                for (int32_t x = 0; x < NUM_STATUS; x++) {
+                    double* dst = FP[y * NUM_STATUS + x];
+                    for (int32_t n = 0; n < len; n++) dst[n] = 0;
+                    for (int32_t k = 0; k < NUM_STATUS; k++) {
+                        const double f = F(y, k);
+                        if (f == 0) continue;
+                        const double* src = P + (k * NUM_STATUS + x) * capacity_;
+#pragma omp simd
+                        for (int32_t n = 0; n < len; n++) dst[n] += f * src[n];
+                    }
+                }
+            }
+
+            /* P = FP * Ft + Q */
+            for (int32_t y = 0; y < NUM_STATUS; y++) {
+                for (int32_t x = 0; x < NUM_STATUS; x++) {
+                    double* dst = P + (y * NUM_STATUS + x) * capacity_;
+                    for (int32_t n = 0; n < len; n++) dst[n] = 0;
+                    for (int32_t k = 0; k < NUM_STATUS; k++) {
+                        const double f = F(x, k);
+                        if (f == 0) continue;
+                        const double* src = FP[y * NUM_STATUS + k];
+#pragma omp simd
+                        for (int32_t n = 0; n < len; n++) dst[n] += src[n] * f;
+                    }
+                    const double q = Q(y, x);
+#pragma omp simd
+                    for (int32_t n = 0; n < len; n++) dst[n] += q;
+                }
+            }
+        }
+    }
+
+    /* Update one object with observed value Z */
+    void Update(int32_t index, const VectorObserve& Z)
+    {
+        Update(&index, &Z, 1);
+    }
+
+    /* Update objects index_list[0:num] with observed values Z_list[0:num] */
+    /* The objects are gathered into a block, and each step is vectorized across the objects in the block (the same as Predict) */
+    /* An object whose S is not invertible is not updated (the same as KalmanFilterFixed) */
+    void Update(const int32_t* index_list, const VectorObserve* Z_list, int32_t num)
+    {
+        double X[NUM_STATUS][kBlockSize];
+        double P[NUM_STATUS * NUM_STATUS][kBlockSize];
+        double e[NUM_OBSERVE][kBlockSize];
+        double HP[NUM_OBSERVE * NUM_STATUS][kBlockSize];   /* also used for P * Ht */
+        double S[NUM_OBSERVE * NUM_OBSERVE][kBlockSize];
+        double S_inv[NUM_OBSERVE * NUM_OBSERVE][kBlockSize];
+        double K[NUM_STATUS * NUM_OBSERVE][kBlockSize];
+        double I_KH[NUM_STATUS * NUM_STATUS][kBlockSize];
+        double P_new[NUM_STATUS * NUM_STATUS][kBlockSize];
+        double scale[kBlockSize];
+        bool is_valid[kBlockSize];
+        for (int32_t block = 0; block < num; block += kBlockSize) {
+            const int32_t len = (std::min)(kBlockSize, num - block);
+            const int32_t* index = index_list + block;
+            for (int32_t i = 0; i < NUM_STATUS; i++) {
+                for (int32_t n = 0; n < len; n++) X[i][n] = X_[i * capacity_ + index[n]];
+            }
+            for (int32_t i = 0; i < NUM_STATUS * NUM_STATUS; i++) {
+                for (int32_t n = 0; n < len; n++) P[i][n] = P_[i * capacity_ + index[n]];
+            }
+
+            /* S = (H * P) * Ht + R */
+            MultiplyConstLeft<NUM_OBSERVE, NUM_STATUS, NUM_STATUS>(HP, H, P, len);
+            MultiplyConstRight<NUM_OBSERVE, NUM_STATUS, NUM_OBSERVE>(S, HP, H_t, len);
+            for (int32_t i = 0; i < NUM_OBSERVE * NUM_OBSERVE; i++) {
+                const double r = R.data_array[i];
+#pragma omp simd
+                for (int32_t n = 0; n < len; n++) S[i][n] += r;
+            }
+
+            /* S_inv = S^-1 (Gauss-Jordan elimination, the same as FixedMatrixUtils::Inverse). S is destroyed */
+            for (int32_t i = 0; i < NUM_OBSERVE * NUM_OBSERVE; i++) {
+                const double value = (i / NUM_OBSERVE == i % NUM_OBSERVE) ? 1.0 : 0.0;
+                for (int32_t n = 0; n < len; n++) S_inv[i][n] = value;
+            }
+            for (int32_t n = 0; n < len; n++) is_valid[n] = true;
+            for (int32_t y = 0; y < NUM_OBSERVE; y++) {
+                const int32_t yy_diag = y * NUM_OBSERVE + y;
+                for (int32_t n = 0; n < len; n++) {
+                    is_valid[n] = is_valid[n] && S[yy_diag][n] != 0;
+                    scale[n] = (S[yy_diag][n] != 0) ? 1.0 / S[yy_diag][n] : 1.0;
+                }
+                for (int32_t x = 0; x < NUM_OBSERVE; x++) {
+#pragma omp simd
+                    for (int32_t n = 0; n < len; n++) {
+                        S[y * NUM_OBSERVE + x][n] *= scale[n];
+                        S_inv[y * NUM_OBSERVE + x][n] *= scale[n];
+                    }
+                }
+                for (int32_t yy = 0; yy < NUM_OBSERVE; yy++) {
+                    if (yy == y) continue;
+                    for (int32_t n = 0; n < len; n++) scale[n] = S[yy * NUM_OBSERVE + y][n];
+                    for (int32_t x = 0; x < NUM_OBSERVE; x++) {
+#pragma omp simd
+                        for (int32_t n = 0; n < len; n++) {
+                            S[yy * NUM_OBSERVE + x][n] -= S[y * NUM_OBSERVE + x][n] * scale[n];
+                            S_inv[yy * NUM_OBSERVE + x][n] -= S_inv[y * NUM_OBSERVE + x][n] * scale[n];
+                        }
+                    }
+                }
+            }
+
+            /* K = P * Ht * S^-1 */
+            MultiplyConstRight<NUM_STATUS, NUM_STATUS, NUM_OBSERVE>(HP, P, H_t, len);
+            Multiply<NUM_STATUS, NUM_OBSERVE, NUM_OBSERVE>(K, HP, S_inv, len);
+
+            /* e = Z - H * X */
+            MultiplyConstLeft<NUM_OBSERVE, NUM_STATUS, 1>(e, H, X, len);
+            for (int32_t i = 0; i < NUM_OBSERVE; i++) {
+                for (int32_t n = 0; n < len; n++) e[i][n] = Z_list[block + n].data_array[i] - e[i][n];
+            }
+
+            /* X = X + K * e */
+            for (int32_t y = 0; y < NUM_STATUS; y++) {
+                for (int32_t n = 0; n < len; n++) scale[n] = 0;
+                for (int32_t k = 0; k < NUM_OBSERVE; k++) {
+#pragma omp simd
+                    for (int32_t n = 0; n < len; n++) scale[n] += K[y * NUM_OBSERVE + k][n] * e[k][n];
+                }
+#pragma omp simd
+                for (int32_t n = 0; n < len; n++) X[y][n] += scale[n];
+            }
+
+            /* P = (I - K * H) * P */
+            MultiplyConstRight<NUM_STATUS, NUM_OBSERVE, NUM_STATUS>(I_KH, K, H, len);
+            for (int32_t y = 0; y < NUM_STATUS; y++) {
+                for (int32_t x = 0; x < NUM_STATUS; x++) {
+                    double* dst = I_KH[y * NUM_STATUS + x];
+                    const double value = (y == x) ? 1.0 : 0.0;
+#pragma omp simd
+                    for (int32_t n = 0; n < len; n++) dst[n] = value - dst[n];
+                }
+            }
+            Multiply<NUM_STATUS, NUM_STATUS, NUM_STATUS>(P_new, I_KH, P, len);
+
+            for (int32_t n = 0; n < len; n++) {
+                if (!is_valid[n]) continue;
+                for (int32_t i = 0; i < NUM_STATUS; i++) X_[i * capacity_ + index[n]] = X[i][n];
+                for (int32_t i = 0; i < NUM_STATUS * NUM_STATUS; i++) P_[i * capacity_ + index[n]] = P_new[i][n];
+            }
+        }
+    }
+
+private:
+    /* out = a * b for each object in a block. a, b and out are (rows * cols) x kBlockSize */
+    template<int32_t M, int32_t K, int32_t N>
+    static void Multiply(double out[][kBlockSize], const double a[][kBlockSize], const double b[][kBlockSize], int32_t len)
+    {
+        for (int32_t y = 0; y < M; y++) {
+            for (int32_t x = 0; x < N; x++) {
+                double* dst = out[y * N + x];
+                for (int32_t n = 0; n < len; n++) dst[n] = 0;
+                for (int32_t k = 0; k < K; k++) {
+                    const double* src_a = a[y * K + k];
+                    const double* src_b = b[k * N + x];
+#pragma omp simd
+                    for (int32_t n = 0; n < len; n++) dst[n] += src_a[n] * src_b[n];
+                }
+            }
+        }
+    }
+
+    /* out = a * b, where a is shared by all objects. Zero elements in a are skipped */
+    template<int32_t M, int32_t K, int32_t N>
+    static void MultiplyConstLeft(double out[][kBlockSize], const FixedMatrix<M, K>& a, const double b[][kBlockSize], int32_t len)
+    {
+        for (int32_t y = 0; y < M; y++) {
+            for (int32_t x = 0; x < N; x++) {
+                double* dst = out[y * N + x];
+                for (int32_t n = 0; n < len; n++) dst[n] = 0;
+                for (int32_t k = 0; k < K; k++) {
+                    const double value = a(y, k);
+                    if (value == 0) continue;
+                    const double* src = b[k * N + x];
+#pragma omp simd
+                    for (int32_t n = 0; n < len; n++) dst[n] += value * src[n];
+                }
+            }
+        }
+    }
+
+    /* out = a * b, where b is shared by all objects. Zero elements in b are skipped */
+    template<int32_t M, int32_t K, int32_t N>
+    static void MultiplyConstRight(double out[][kBlockSize], const double a[][kBlockSize], const FixedMatrix<K, N>& b, int32_t len)
+    {
+        for (int32_t y = 0; y < M; y++) {
+            for (int32_t x = 0; x < N; x++) {
+                double* dst = out[y * N + x];
+                for (int32_t n = 0; n < len; n++) dst[n] = 0;
+                for (int32_t k = 0; k < K; k++) {
+                    const double value = b(k, x);
+                    if (value == 0) continue;
+                    const double* src = a[y * K + k];
+#pragma omp simd
+                    for (int32_t n = 0; n < len; n++) dst[n] += src[n] * value;
+                }
+            }
+        }
+    }
+
+public:
+    /*** X(t) = F * X(t-1) + w(t) ***/
+    MatrixStatus F;
+    MatrixStatus Q;
+
+    /*** Z(t) = H * X(t) + v(t) ***/
+    MatrixObserveStatus H;
+    MatrixObserve R;
+
+private:
+    MatrixStatusObserve H_t;
+    int32_t capacity_;
+    std::vector<double> X_;
+    std::vector<double> P_;
+};
+
+template<int32_t NUM_STATUS, int32_t NUM_OBSERVE>
+constexpr int32_t KalmanFilterBatch<NUM_STATUS, NUM_OBSERVE>::kBlockSize;
+
+#endif
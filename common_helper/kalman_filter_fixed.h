@@ -0,0 +1,139 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef KALMAN_FILTER_FIXED_H_
+#define KALMAN_FILTER_FIXED_H_
+
+#include <cstdint>
+
+#include "fixed_matrix.h"
+
+/* Kalman filter whose dimensions are decided at compile time. The same calculation as KalmanFilter, but without heap allocation */
+template<int32_t NUM_STATUS, int32_t NUM_OBSERVE>
+class KalmanFilterFixed {
+public:
+    typedef FixedMatrix<NUM_STATUS, NUM_STATUS>  MatrixStatus;
+    typedef FixedMatrix<NUM_STATUS, 1>           VectorStatus;
+    typedef FixedMatrix<NUM_OBSERVE, NUM_OBSERVE> MatrixObserve;
+    typedef FixedMatrix<NUM_OBSERVE, 1>          VectorObserve;
+    typedef FixedMatrix<NUM_OBSERVE, NUM_STATUS> MatrixObserveStatus;
+    typedef FixedMatrix<NUM_STATUS, NUM_OBSERVE> MatrixStatusObserve;
+
+public:
+    KalmanFilterFixed() {}
+    ~KalmanFilterFixed() {}
+
+    void Initialize(
+        const MatrixStatus& _F,
+        const MatrixStatus& _Q,
+        const MatrixObserveStatus& _H,
+        const MatrixObserve& _R,
+        const VectorStatus& _X,
+        const MatrixStatus& _P
+    )
+    {
+        F = _F;
+        Q = _Q;
+        H = _H;
+        R = _R;
+        X = _X;
+        P = _P;
+        F_t = F.Transpose();
+        H_t = H.Transpose();
+    }
+
+    void Predict()
+    {
+        using namespace FixedMatrixUtils;
+        /* X = F * X */
+        VectorStatus X_prev = X;
+        Multiply(X, F, X_prev);
+        /* P = F * P * Ft + Q */
+        MatrixStatus FP;
+        Multiply(FP, F, P);
+        Multiply(P, FP, F_t);
+        AddInPlace(P, Q);
+    }
+
+    void Update(const VectorObserve& Z)
+    {
+        Update(X, P, Z, H, H_t, R);
+    }
+
+    /* Update X and P with observed value Z. Also used by KalmanFilterBatch */
+    static void Update(VectorStatus& X, MatrixStatus& P, const VectorObserve& Z, const MatrixObserveStatus& H, const MatrixStatusObserve& H_t, const MatrixObserve& R)
+    {
+        using namespace FixedMatrixUtils;
+        /* S = (H * P) * Ht + R */
+        MatrixObserveStatus HP;
+        Multiply(HP, H, P);
+        MatrixObserve S;
+        Multiply(S, HP, H_t);
+        AddInPlace(S, R);
+
+        /* K = P * Ht * S^-1 */
+        MatrixObserve S_inv;
+        if (!Inverse(S_inv, S)) return;
+        MatrixStatusObserve PHt;
+        Multiply(PHt, P, H_t);
+        MatrixStatusObserve K;
+        Multiply(K, PHt, S_inv);
+
+        /* e = Z - H * X */
+        VectorObserve e;
+        Multiply(e, H, X);
+        for (int32_t i = 0; i < NUM_OBSERVE; i++) e.data_array[i] = Z.data_array[i] - e.data_array[i];
+
+        /* X = X + K * e */
+        VectorStatus Ke;
+        Multiply(Ke, K, e);
+        AddInPlace(X, Ke);
+
+        /* P = (I - K * H) * P */
+        MatrixStatus I_KH;
+        Multiply(I_KH, K, H);
+        for (int32_t y = 0; y < NUM_STATUS; y++) {
+            for (int32_t x = 0; x < NUM_STATUS; x++) {
+                I_KH(y, x) = (y == x ? 1.0 : 0.0) - I_KH(y, x);
+            }
+        }
+        MatrixStatus P_prev = P;
+        Multiply(P, I_KH, P_prev);
+    }
+
+public:
+    /*** X(t) = F * X(t-1) + w(t) ***/
+    /* Matrix to calculate X(t) from X(t-1) */
+    MatrixStatus F;
+    /* w(t), = noise, follows Q */
+    MatrixStatus Q;
+
+    /*** Z(t) = H * X(t) + v(t) ***/
+    /* Matrix to calculate Z(observed value) from X(internal status) */
+    MatrixObserveStatus H;
+    /* v(t), = noise, follows R */
+    MatrixObserve R;
+
+    /*** Internal status ***/
+    VectorStatus X;
+    MatrixStatus P;
+
+private:
+    /* Transposes are calculated only once at Initialize */
+    MatrixStatus F_t;
+    MatrixStatusObserve H_t;
+};
+
+
+#endif
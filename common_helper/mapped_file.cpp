@@ -0,0 +1,127 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+/*** Include ***/
+/* for general */
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/* for My modules */
+#include "common_helper.h"
+#include "mapped_file.h"
+
+/*** Macro ***/
+#define TAG "MappedFile"
+#define PRINT(...)   COMMON_HELPER_PRINT(TAG, __VA_ARGS__)
+#define PRINT_E(...) COMMON_HELPER_PRINT_E(TAG, __VA_ARGS__)
+
+/*** Function ***/
+#ifdef _WIN32
+MappedFile::MappedFile() : data_(nullptr), size_(0), file_handle_(INVALID_HANDLE_VALUE), mapping_handle_(nullptr)
+{
+}
+#else
+MappedFile::MappedFile() : data_(nullptr), size_(0)
+{
+}
+#endif
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+#ifdef _WIN32
+int32_t MappedFile::Open(const std::string& filename)
+{
+    Close();
+    file_handle_ = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_handle_ == INVALID_HANDLE_VALUE) {
+        PRINT_E("Failed to open %s\n", filename.c_str());
+        return kRetErr;
+    }
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file_handle_, &file_size) || file_size.QuadPart == 0) {
+        PRINT_E("Invalid file size %s\n", filename.c_str());
+        Close();
+        return kRetErr;
+    }
+    mapping_handle_ = CreateFileMappingA(file_handle_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping_handle_) {
+        PRINT_E("Failed to map %s\n", filename.c_str());
+        Close();
+        return kRetErr;
+    }
+    data_ = static_cast<const uint8_t*>(MapViewOfFile(mapping_handle_, FILE_MAP_READ, 0, 0, 0));
+    if (!data_) {
+        PRINT_E("Failed to map %s\n", filename.c_str());
+        Close();
+        return kRetErr;
+    }
+    size_ = static_cast<size_t>(file_size.QuadPart);
+    return kRetOk;
+}
+
+void MappedFile::Close()
+{
+    if (data_) UnmapViewOfFile(data_);
+    if (mapping_handle_) CloseHandle(mapping_handle_);
+    if (file_handle_ != INVALID_HANDLE_VALUE) CloseHandle(file_handle_);
+    data_ = nullptr;
+    size_ = 0;
+    mapping_handle_ = nullptr;
+    file_handle_ = INVALID_HANDLE_VALUE;
+}
+#else
+int32_t MappedFile::Open(const std::string& filename)
+{
+    Close();
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        PRINT_E("Failed to open %s\n", filename.c_str());
+        return kRetErr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        PRINT_E("Invalid file size %s\n", filename.c_str());
+        close(fd);
+        return kRetErr;
+    }
+    void* addr = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);      /* the mapping is still valid after the file is closed */
+    if (addr == MAP_FAILED) {
+        PRINT_E("Failed to map %s\n", filename.c_str());
+        return kRetErr;
+    }
+    data_ = static_cast<const uint8_t*>(addr);
+    size_ = static_cast<size_t>(st.st_size);
+    return kRetOk;
+}
+
+void MappedFile::Close()
+{
+    if (data_) munmap(const_cast<uint8_t*>(data_), size_);
+    data_ = nullptr;
+    size_ = 0;
+}
+#endif
@@ -0,0 +1,52 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef MAPPED_FILE_
+#define MAPPED_FILE_
+
+/* for general */
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+/* Read-only memory mapped file. Pages are loaded on access and shared with the OS file cache, so nothing is copied at open */
+/* The address is page aligned, so it can be passed to loaders which require aligned memory (e.g. ncnn::Net::load_model(const unsigned char*)) */
+class MappedFile {
+public:
+    enum {
+        kRetOk = 0,
+        kRetErr = -1,
+    };
+
+public:
+    MappedFile();
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    int32_t Open(const std::string& filename);
+    void Close();
+    const uint8_t* GetData() const { return data_; }
+    size_t GetSize() const { return size_; }
+
+private:
+    const uint8_t* data_;
+    size_t size_;
+#ifdef _WIN32
+    void* file_handle_;
+    void* mapping_handle_;
+#endif
+};
+
+#endif
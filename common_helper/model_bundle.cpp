@@ -0,0 +1,263 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+/*** Include ***/
+/* for general */
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <sstream>
+#include <iterator>
+
+/* for My modules */
+#include "common_helper.h"
+#include "mapped_file.h"
+#include "model_bundle.h"
+
+/*** Macro ***/
+#define TAG "ModelBundle"
+#define PRINT(...)   COMMON_HELPER_PRINT(TAG, __VA_ARGS__)
+#define PRINT_E(...) COMMON_HELPER_PRINT_E(TAG, __VA_ARGS__)
+
+static constexpr char kMagic[4] = { 'M', 'D', 'L', 'B' };
+static constexpr uint32_t kVersion = 1;
+static constexpr size_t kSectionNameSize = 16;
+static constexpr size_t kHeaderSize = 16;
+static constexpr size_t kSectionEntrySize = kSectionNameSize + 8 + 8;
+
+constexpr size_t ModelBundle::kAlignment;
+
+/*** Function ***/
+static inline size_t AlignUp(size_t val, size_t alignment)
+{
+    return (val + alignment - 1) / alignment * alignment;
+}
+
+static std::string Trim(const std::string& str)
+{
+    const char* kSpace = " \t\r\n";
+    size_t start = str.find_first_not_of(kSpace);
+    if (start == std::string::npos) return "";
+    size_t end = str.find_last_not_of(kSpace);
+    return str.substr(start, end - start + 1);
+}
+
+int32_t ModelBundle::Open(const std::string& filename)
+{
+    Close();
+    if (file_.Open(filename) != MappedFile::kRetOk) {
+        return kRetErr;
+    }
+
+    /* Header */
+    const uint8_t* data = file_.GetData();
+    const size_t file_size = file_.GetSize();
+    uint32_t version = 0;
+    uint32_t section_num = 0;
+    if (file_size < kHeaderSize || std::memcmp(data, kMagic, sizeof(kMagic)) != 0) {
+        PRINT_E("Invalid bundle %s\n", filename.c_str());
+        Close();
+        return kRetErr;
+    }
+    std::memcpy(&version, data + 4, sizeof(version));
+    std::memcpy(&section_num, data + 8, sizeof(section_num));
+    if (version != kVersion || file_size < kHeaderSize + static_cast<uint64_t>(section_num) * kSectionEntrySize) {
+        PRINT_E("Unsupported bundle %s (version = %u)\n", filename.c_str(), version);
+        Close();
+        return kRetErr;
+    }
+
+    /* Section table */
+    for (uint32_t i = 0; i < section_num; i++) {
+        const uint8_t* entry = data + kHeaderSize + i * kSectionEntrySize;
+        char name[kSectionNameSize + 1] = { 0 };
+        std::memcpy(name, entry, kSectionNameSize);
+        Section section;
+        std::memcpy(&section.offset, entry + kSectionNameSize, sizeof(section.offset));
+        std::memcpy(&section.size, entry + kSectionNameSize + 8, sizeof(section.size));
+        if (section.offset > file_size || section.size > file_size - section.offset) {
+            PRINT_E("Broken section %s in %s\n", name, filename.c_str());
+            Close();
+            return kRetErr;
+        }
+        section_map_[name] = section;
+    }
+
+    /* Metadata */
+    const uint8_t* meta = nullptr;
+    size_t meta_size = 0;
+    if (GetSection("meta", meta, meta_size)) {
+        std::istringstream iss(std::string(reinterpret_cast<const char*>(meta), meta_size));
+        std::string line;
+        while (std::getline(iss, line)) {
+            line = Trim(line);
+            if (line.empty() || line[0] == '#') continue;
+            size_t pos = line.find('=');
+            if (pos == std::string::npos) continue;
+            meta_map_[Trim(line.substr(0, pos))] = Trim(line.substr(pos + 1));
+        }
+    }
+
+    return kRetOk;
+}
+
+void ModelBundle::Close()
+{
+    file_.Close();
+    section_map_.clear();
+    meta_map_.clear();
+}
+
+bool ModelBundle::GetSection(const std::string& name, const uint8_t*& data, size_t& size) const
+{
+    const auto& it = section_map_.find(name);
+    if (it == section_map_.end()) return false;
+    data = file_.GetData() + it->second.offset;
+    size = static_cast<size_t>(it->second.size);
+    return true;
+}
+
+std::string ModelBundle::GetMeta(const std::string& key, const std::string& default_value) const
+{
+    const auto& it = meta_map_.find(key);
+    if (it == meta_map_.end()) return default_value;
+    return it->second;
+}
+
+std::vector<std::string> ModelBundle::GetMetaStringList(const std::string& key) const
+{
+    std::vector<std::string> value_list;
+    std::istringstream iss(GetMeta(key));
+    std::string value;
+    while (std::getline(iss, value, ',')) {
+        value_list.push_back(Trim(value));
+    }
+    return value_list;
+}
+
+std::vector<int32_t> ModelBundle::GetMetaIntList(const std::string& key) const
+{
+    std::vector<int32_t> value_list;
+    for (const auto& value : GetMetaStringList(key)) value_list.push_back(std::atoi(value.c_str()));
+    return value_list;
+}
+
+std::vector<float> ModelBundle::GetMetaFloatList(const std::string& key) const
+{
+    std::vector<float> value_list;
+    for (const auto& value : GetMetaStringList(key)) value_list.push_back(static_cast<float>(std::atof(value.c_str())));
+    return value_list;
+}
+
+void ModelBundle::GetLabelList(std::vector<std::string>& label_list) const
+{
+    label_list.clear();
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    if (!GetSection("label", data, size)) return;
+    std::istringstream iss(std::string(reinterpret_cast<const char*>(data), size));
+    std::string str;
+    while (std::getline(iss, str)) {
+        if (!str.empty() && str.back() == '\r') str.pop_back();
+        label_list.push_back(str);
+    }
+}
+
+int32_t ModelBundle::GetModelInfo(std::string& input_name, std::vector<int32_t>& input_dims, float input_mean[3], float input_norm[3], bool& is_rgb, std::vector<std::string>& output_name_list) const
+{
+    std::vector<int32_t> meta_input_dims = GetMetaIntList("input_dims");
+    std::vector<float> meta_input_mean = GetMetaFloatList("input_mean");
+    std::vector<float> meta_input_norm = GetMetaFloatList("input_norm");
+    std::vector<std::string> meta_output_name_list = GetMetaStringList("output_name_list");
+    if (!meta_input_dims.empty() && meta_input_dims.size() != 4) {
+        PRINT_E("Invalid input_dims\n");
+        return kRetErr;
+    }
+    if ((!meta_input_mean.empty() && meta_input_mean.size() != 3) || (!meta_input_norm.empty() && meta_input_norm.size() != 3)) {
+        PRINT_E("Invalid input_mean or input_norm\n");
+        return kRetErr;
+    }
+    if (!meta_output_name_list.empty() && meta_output_name_list.size() != output_name_list.size()) {
+        PRINT_E("Invalid output_name_list (%zu names are required)\n", output_name_list.size());
+        return kRetErr;
+    }
+
+    input_name = GetMeta("input_name", input_name);
+    if (!meta_input_dims.empty()) input_dims = meta_input_dims;
+    for (size_t i = 0; i < meta_input_mean.size(); i++) input_mean[i] = meta_input_mean[i];
+    for (size_t i = 0; i < meta_input_norm.size(); i++) input_norm[i] = meta_input_norm[i];
+    is_rgb = GetMeta("is_rgb", is_rgb ? "1" : "0") != "0";
+    if (!meta_output_name_list.empty()) output_name_list = meta_output_name_list;
+    return kRetOk;
+}
+
+int32_t ModelBundle::Create(const std::string& filename, const std::vector<std::pair<std::string, std::string>>& section_file_list)
+{
+    /* Read all files */
+    std::vector<std::vector<char>> content_list;
+    for (const auto& section_file : section_file_list) {
+        if (section_file.first.empty() || section_file.first.size() >= kSectionNameSize) {
+            PRINT_E("Invalid section name %s\n", section_file.first.c_str());
+            return kRetErr;
+        }
+        std::ifstream ifs(section_file.second, std::ios::binary);
+        if (ifs.fail()) {
+            PRINT_E("Failed to read %s\n", section_file.second.c_str());
+            return kRetErr;
+        }
+        content_list.push_back(std::vector<char>((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>()));
+    }
+
+    /* Header and section table */
+    const uint32_t section_num = static_cast<uint32_t>(section_file_list.size());
+    std::vector<char> header(kHeaderSize + section_num * kSectionEntrySize, 0);
+    std::memcpy(header.data(), kMagic, sizeof(kMagic));
+    std::memcpy(header.data() + 4, &kVersion, sizeof(kVersion));
+    std::memcpy(header.data() + 8, &section_num, sizeof(section_num));
+    uint64_t offset = AlignUp(header.size(), kAlignment);
+    for (uint32_t i = 0; i < section_num; i++) {
+        char* entry = header.data() + kHeaderSize + i * kSectionEntrySize;
+        uint64_t size = content_list[i].size();
+        std::memcpy(entry, section_file_list[i].first.c_str(), section_file_list[i].first.size());
+        std::memcpy(entry + kSectionNameSize, &offset, sizeof(offset));
+        std::memcpy(entry + kSectionNameSize + 8, &size, sizeof(size));
+        offset = AlignUp(offset + size + 1, kAlignment);    /* +1 for '\0' */
+    }
+
+    /* Write */
+    std::ofstream ofs(filename, std::ios::binary);
+    if (ofs.fail()) {
+        PRINT_E("Failed to write %s\n", filename.c_str());
+        return kRetErr;
+    }
+    ofs.write(header.data(), header.size());
+    uint64_t pos = header.size();
+    for (const auto& content : content_list) {
+        std::vector<char> padding(AlignUp(pos, kAlignment) - pos, 0);
+        ofs.write(padding.data(), padding.size());
+        ofs.write(content.data(), content.size());
+        ofs.put('\0');
+        pos = AlignUp(pos, kAlignment) + content.size() + 1;
+    }
+    if (ofs.fail()) {
+        PRINT_E("Failed to write %s\n", filename.c_str());
+        return kRetErr;
+    }
+    return kRetOk;
+}
@@ -0,0 +1,86 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef MODEL_BUNDLE_
+#define MODEL_BUNDLE_
+
+/* for general */
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+
+/* for My modules */
+#include "mapped_file.h"
+
+/* Single file which packs model files and metadata. The whole file is memory mapped once at Open */
+/* Layout (little endian):
+ *   Header  : magic "MDLB", version(u32), section_num(u32), reserved(u32)
+ *   Section : name(char[16]), offset(u64), size(u64)   x section_num
+ *   Data    : each section starts at kAlignment byte boundary, and is followed by '\0' (not included in size)
+ * Sections:
+ *   meta  : "key=value" lines. input_name, input_dims, input_mean, input_norm, is_rgb, output_name_list, ...
+ *   label : label text (one label per line)
+ *   param : ncnn param (optional)
+ *   bin   : ncnn weights (optional)
+ * Engines read meta and label only, because InferenceHelper loads a model from a file path (model_file in meta). Don't pack param and bin for them.
+ * So the engines still read the model files separately from the bundle.
+ * param and bin are for tools which load ncnn::Net from memory directly (e.g. benchmark_startup)
+ */
+class ModelBundle {
+public:
+    enum {
+        kRetOk = 0,
+        kRetErr = -1,
+    };
+    static constexpr size_t kAlignment = 64;
+
+public:
+    ModelBundle() {}
+    ~ModelBundle() {}
+
+    int32_t Open(const std::string& filename);
+    void Close();
+    bool IsOpened() const { return file_.GetData() != nullptr; }
+
+    /* data is valid until Close */
+    bool GetSection(const std::string& name, const uint8_t*& data, size_t& size) const;
+
+    std::string GetMeta(const std::string& key, const std::string& default_value = "") const;
+    std::vector<std::string> GetMetaStringList(const std::string& key) const;   /* comma separated */
+    std::vector<int32_t> GetMetaIntList(const std::string& key) const;
+    std::vector<float> GetMetaFloatList(const std::string& key) const;
+    void GetLabelList(std::vector<std::string>& label_list) const;
+    /* Overwrite the model information with meta (input_name, input_dims, input_mean, input_norm, is_rgb, output_name_list). Values not in meta are kept */
+    /* output_name_list must have the same number of names as the given list, because engines use outputs by index */
+    int32_t GetModelInfo(std::string& input_name, std::vector<int32_t>& input_dims, float input_mean[3], float input_norm[3], bool& is_rgb, std::vector<std::string>& output_name_list) const;
+
+    /* Pack files into a bundle. section_file_list: pairs of (section name, file name) */
+    static int32_t Create(const std::string& filename, const std::vector<std::pair<std::string, std::string>>& section_file_list);
+
+private:
+    typedef struct Section_ {
+        uint64_t offset;
+        uint64_t size;
+    } Section;
+
+private:
+    MappedFile file_;
+    std::map<std::string, Section> section_map_;
+    std::map<std::string, std::string> meta_map_;
+};
+
+#endif
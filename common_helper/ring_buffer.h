@@ -0,0 +1,63 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef RING_BUFFER_
+#define RING_BUFFER_
+
+#include <cstdint>
+#include <cstddef>
+
+/* Fixed capacity ring buffer held in the object itself (no heap allocation). The oldest element is overwritten when full */
+/* Index 0 is the oldest element, like std::deque used with push_back and pop_front */
+template<typename T, int32_t CAPACITY>
+class RingBuffer
+{
+public:
+    RingBuffer() : head_(0), size_(0) {}
+
+    void push_back(const T& val)
+    {
+        if (size_ < CAPACITY) {
+            data_[(head_ + size_) % CAPACITY] = val;
+            size_++;
+        } else {
+            data_[head_] = val;
+            head_ = (head_ + 1) % CAPACITY;
+        }
+    }
+
+    void clear()
+    {
+        head_ = 0;
+        size_ = 0;
+    }
+
+    size_t size() const { return static_cast<size_t>(size_); }
+    bool empty() const { return size_ == 0; }
+    static constexpr int32_t capacity() { return CAPACITY; }
+
+    T& operator[] (size_t i) { return data_[(head_ + i) % CAPACITY]; }
+    const T& operator[] (size_t i) const { return data_[(head_ + i) % CAPACITY]; }
+    T& front() { return data_[head_]; }
+    const T& front() const { return data_[head_]; }
+    T& back() { return data_[(head_ + size_ - 1) % CAPACITY]; }
+    const T& back() const { return data_[(head_ + size_ - 1) % CAPACITY]; }
+
+private:
+    T data_[CAPACITY];
+    int32_t head_;
+    int32_t size_;
+};
+
+#endif
@@ -20,6 +20,7 @@ limitations under the License.
 #include <cstdlib>
 #include <vector>
 #include <stdexcept>
+#include <cassert>
 
 class SimpleMatrix
 {
@@ -66,59 +67,106 @@ public:
 		return data_array[y * cols + x];
 	}
 
+	/* Accessor without bounds check for hot loops. Index is checked only in debug build */
+	double& At(int32_t y, int32_t x)
+	{
+		assert(y >= 0 && x >= 0 && y < rows && x < cols);
+		return data_array[y * cols + x];
+	}
+
+	const double& At(int32_t y, int32_t x) const
+	{
+		assert(y >= 0 && x >= 0 && y < rows && x < cols);
+		return data_array[y * cols + x];
+	}
+
 	const SimpleMatrix operator+ (const SimpleMatrix& mat2) const
+	{
+		SimpleMatrix ret = *this;
+		ret.AddInPlace(mat2);
+		return ret;
+	}
+
+	const SimpleMatrix operator- (const SimpleMatrix& mat2) const
+	{
+		SimpleMatrix ret = *this;
+		ret.SubInPlace(mat2);
+		return ret;
+	}
+
+	const SimpleMatrix operator* (const SimpleMatrix& mat2) const 
+	{
+		SimpleMatrix ret;
+		Multiply(ret, *this, mat2);
+		return ret;
+	}
+
+	/*** In-place operations. Memory is not allocated when the output matrix already has enough capacity ***/
+	/* this += mat2 */
+	void AddInPlace(const SimpleMatrix& mat2)
 	{
 		if (!CheckShape() || !mat2.CheckShape() || !CheckShapeSame(mat2)) {
 			throw std::out_of_range("Invalid shape at add");
 		}
-
-		const SimpleMatrix& mat1 = *this;
-		SimpleMatrix ret(mat1.rows, mat1.cols);
-
-		for (int32_t y = 0; y < rows; y++) {
-			for (int32_t x = 0; x < cols; x++) {
-				ret(y, x) = mat1(y, x) + mat2(y, x);
-			}
+		for (size_t i = 0; i < data_array.size(); i++) {
+			data_array[i] += mat2.data_array[i];
 		}
-		return ret;
 	}
 
-	const SimpleMatrix operator- (const SimpleMatrix& mat2) const
+	/* this -= mat2 */
+	void SubInPlace(const SimpleMatrix& mat2)
 	{
 		if (!CheckShape() || !mat2.CheckShape() || !CheckShapeSame(mat2)) {
 			throw std::out_of_range("Invalid shape at sub");
 		}
+		for (size_t i = 0; i < data_array.size(); i++) {
+			data_array[i] -= mat2.data_array[i];
+		}
+	}
 
-		const SimpleMatrix& mat1 = *this;
-		SimpleMatrix ret(mat1.rows, mat1.cols);
+	/* out = mat1 * mat2. out must be a different object from mat1 and mat2 */
+	static void Multiply(SimpleMatrix& out, const SimpleMatrix& mat1, const SimpleMatrix& mat2)
+	{
+		if (!mat1.CheckShape() || !mat2.CheckShape() || !mat1.CheckShapeMul(mat2) || &out == &mat1 || &out == &mat2) {
+			throw std::out_of_range("Invalid shape at mul");
+		}
+		out.Reshape(mat1.rows, mat2.cols);
 
-		for (int32_t y = 0; y < rows; y++) {
-			for (int32_t x = 0; x < cols; x++) {
-				ret(y, x) = mat1(y, x) - mat2(y, x);
+		for (int32_t y = 0; y < mat1.rows; y++) {
+			for (int32_t x = 0; x < mat2.cols; x++) {
+				double sum = 0;
+				for (int32_t i = 0; i < mat1.cols; i++) {
+					sum += mat1.At(y, i) * mat2.At(i, x);
+				}
+				out.At(y, x) = sum;
 			}
 		}
-		return ret;
 	}
 
-	const SimpleMatrix operator* (const SimpleMatrix& mat2) const 
+	/* out = mat1 * mat2.Transpose(), without creating the transposed matrix. out must be a different object from mat1 and mat2 */
+	static void MultiplyTransposed(SimpleMatrix& out, const SimpleMatrix& mat1, const SimpleMatrix& mat2)
 	{
-		if (!CheckShape() || !mat2.CheckShape() || !CheckShapeMul(mat2)) {
+		if (!mat1.CheckShape() || !mat2.CheckShape() || mat1.cols != mat2.cols || &out == &mat1 || &out == &mat2) {
 			throw std::out_of_range("Invalid shape at mul");
 		}
-		
-		const SimpleMatrix& mat1 = *this;
-		SimpleMatrix ret(mat1.rows, mat2.cols);
+		out.Reshape(mat1.rows, mat2.rows);
 
 		for (int32_t y = 0; y < mat1.rows; y++) {
-			for (int32_t x = 0; x < mat2.cols; x++) {
+			for (int32_t x = 0; x < mat2.rows; x++) {
 				double sum = 0;
 				for (int32_t i = 0; i < mat1.cols; i++) {
-					sum += mat1(y, i) * mat2(i, x);
+					sum += mat1.At(y, i) * mat2.At(x, i);
 				}
-				ret(y, x) = sum;
+				out.At(y, x) = sum;
 			}
 		}
-		return ret;
+	}
+
+	void Reshape(int32_t _rows, int32_t _cols)
+	{
+		rows = _rows;
+		cols = _cols;
+		data_array.resize(rows * cols);
 	}
 
 	const SimpleMatrix operator* (const double& k) const
@@ -158,10 +206,30 @@ public:
 			throw std::out_of_range("SimpleMatrix");
 		}
 
-		SimpleMatrix mat = *this;
+		SimpleMatrix I;
+		SimpleMatrix work;
+		Inverse(I, work, *this);
+		return I;
+	}
+
+	/* out = mat.Inverse(). work is used as a copy of mat. out and work must be different objects from mat */
+	static void Inverse(SimpleMatrix& out, SimpleMatrix& work, const SimpleMatrix& mat1)
+	{
+		if (!mat1.CheckShape() || mat1.rows != mat1.cols || &out == &mat1 || &work == &mat1 || &out == &work) {
+			throw std::out_of_range("Invalid shape at Inverse");
+		}
+
+		SimpleMatrix& mat = work;
+		mat = mat1;
 		int32_t n = mat.rows;
-		SimpleMatrix I = SimpleMatrix::IdentityMatrix(n);
-		
+		SimpleMatrix& I = out;
+		I.Reshape(n, n);
+		for (int32_t y = 0; y < n; y++) {
+			for (int32_t x = 0; x < n; x++) {
+				I.At(y, x) = (y == x) ? 1 : 0;
+			}
+		}
+
 		for (int32_t y = 0; y < n; y++) {
 			if (mat(y, y) == 0) {
 				throw std::out_of_range("Tried to calculate an inverse of non - singular matrix");
@@ -181,8 +249,6 @@ public:
 				}
 			}
 		}
-
-		return I;
 	}
 
 
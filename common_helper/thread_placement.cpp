@@ -0,0 +1,256 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+/*** Include ***/
+/* for general */
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#if defined(__linux__) || defined(__ANDROID__)
+#include <sched.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
+
+/* for My modules */
+#include "common_helper.h"
+#include "thread_placement.h"
+
+/*** Macro ***/
+#define TAG "ThreadPlacement"
+#define PRINT(...)   COMMON_HELPER_PRINT(TAG, __VA_ARGS__)
+#define PRINT_E(...) COMMON_HELPER_PRINT_E(TAG, __VA_ARGS__)
+
+/*** Function ***/
+/* Parse a non-negative number which is the whole of str */
+static bool ParseCoreNumber(const std::string& str, int32_t& number)
+{
+    if (str.empty() || str.find_first_not_of("0123456789") != std::string::npos) return false;
+    number = std::atoi(str.c_str());
+    return true;
+}
+
+ThreadPlacement::ThreadPlacement() : num_threads_(1), is_applied_(false)
+{
+}
+
+int32_t ThreadPlacement::Initialize(const std::string& affinity, int32_t num_threads)
+{
+    core_list_.clear();
+    is_applied_ = false;
+    if (affinity == "all") {
+        for (int32_t i = 0; i < GetCoreNum(); i++) core_list_.push_back(i);
+    } else if (affinity == "big" || affinity == "little") {
+        core_list_ = GetClusterCoreList(affinity == "big");
+    } else if (!affinity.empty()) {
+        if (ParseCoreList(affinity, core_list_) != kRetOk) {
+            PRINT_E("Invalid cpu affinity: %s\n", affinity.c_str());
+            return kRetErr;
+        }
+    }
+
+    if (num_threads > 0) {
+        num_threads_ = num_threads;
+    } else {
+        num_threads_ = core_list_.empty() ? GetCoreNum() : static_cast<int32_t>(core_list_.size());
+    }
+
+#ifndef _OPENMP
+    if (!core_list_.empty()) {
+        /* Inference runs on the calling thread only, which is not pinned */
+        PRINT("cpu affinity is ignored, because OpenMP is disabled\n");
+        core_list_.clear();
+    }
+#endif
+    if (core_list_.empty()) {
+        PRINT("Inference threads: %d (not pinned)\n", num_threads_);
+    } else {
+        std::string str;
+        for (const auto& core : core_list_) str += (str.empty() ? "" : ",") + std::to_string(core);
+        PRINT("Inference threads: %d, worker threads pinned to cores: %s\n", num_threads_, str.c_str());
+        if (num_threads_ <= 1) {
+            PRINT("No thread is pinned, because inference runs only on the calling thread\n");
+        } else if (num_threads_ > static_cast<int32_t>(core_list_.size())) {
+            PRINT("Some threads share a core, because there are more threads than cores\n");
+        }
+    }
+    return kRetOk;
+}
+
+/* OpenMP runtimes keep the worker threads of a thread for the next parallel region with the same number of threads, */
+/* so pinning them once here is kept while the inference engine uses num_threads */
+/* OpenMP thread 0 is the calling thread (e.g. main thread, JNI thread) which also runs capture, render and so on. It's not pinned */
+int32_t ThreadPlacement::Apply()
+{
+    if (core_list_.empty()) return kRetOk;
+    if (is_applied_ && applied_thread_id_ == std::this_thread::get_id()) return kRetOk;
+
+    int32_t ret = kRetOk;
+#ifdef _OPENMP
+    /* Worker thread i is pinned to core_list_[i % size]. core_list_[0] is left for the calling thread unless there are more threads than cores */
+    std::vector<std::vector<int32_t>> original_core_list(num_threads_);
+    std::vector<uint8_t> is_pinned(num_threads_, 0);    /* not vector<bool>, which can't be written from threads in parallel */
+#pragma omp parallel num_threads(num_threads_)
+    {
+        const int32_t tid = omp_get_thread_num();
+        if (tid != 0) {
+            const int32_t core = core_list_[tid % core_list_.size()];
+            if (GetCurrentThreadAffinity(original_core_list[tid]) == kRetOk && SetCurrentThreadAffinity({ core }) == kRetOk) {
+                is_pinned[tid] = 1;
+            } else {
+#pragma omp critical
+                ret = kRetErr;
+            }
+        }
+    }
+    if (ret != kRetOk) {
+        /* Undo the threads already pinned */
+#pragma omp parallel num_threads(num_threads_)
+        {
+            const int32_t tid = omp_get_thread_num();
+            if (is_pinned[tid]) SetCurrentThreadAffinity(original_core_list[tid]);
+        }
+    }
+#endif
+    if (ret != kRetOk) {
+        /* Give up pinning, so that it's not retried at every call */
+        PRINT_E("Failed to set thread affinity. Threads are not pinned\n");
+        core_list_.clear();
+        return kRetErr;
+    }
+    is_applied_ = true;
+    applied_thread_id_ = std::this_thread::get_id();
+    return kRetOk;
+}
+
+std::vector<int32_t> ThreadPlacement::GetOtherCoreList() const
+{
+    std::vector<int32_t> other_core_list;
+    for (int32_t i = 0; i < GetCoreNum(); i++) {
+        if (std::find(core_list_.begin(), core_list_.end(), i) == core_list_.end()) other_core_list.push_back(i);
+    }
+    return other_core_list;
+}
+
+int32_t ThreadPlacement::GetCoreNum()
+{
+    return (std::max)(static_cast<int32_t>(std::thread::hardware_concurrency()), 1);
+}
+
+std::vector<int32_t> ThreadPlacement::GetClusterCoreList(bool is_big)
+{
+    const int32_t core_num = GetCoreNum();
+    std::vector<int32_t> freq_list(core_num, 0);
+#if defined(__linux__) || defined(__ANDROID__)
+    for (int32_t i = 0; i < core_num; i++) {
+        char filename[128];
+        snprintf(filename, sizeof(filename), "/sys/devices/system/cpu/cpu%d/cpufreq/cpuinfo_max_freq", i);
+        FILE* fp = fopen(filename, "r");
+        if (!fp) continue;
+        if (fscanf(fp, "%d", &freq_list[i]) != 1) freq_list[i] = 0;
+        fclose(fp);
+    }
+#endif
+    const int32_t freq_max = *std::max_element(freq_list.begin(), freq_list.end());
+    const int32_t freq_min = *std::min_element(freq_list.begin(), freq_list.end());
+    std::vector<int32_t> core_list;
+    for (int32_t i = 0; i < core_num; i++) {
+        if (freq_max == freq_min || (is_big ? freq_list[i] == freq_max : freq_list[i] < freq_max)) core_list.push_back(i);
+    }
+    return core_list;
+}
+
+/* e.g. "4-7", "0,2,4", "0-1,4-5" */
+int32_t ThreadPlacement::ParseCoreList(const std::string& str, std::vector<int32_t>& core_list)
+{
+    core_list.clear();
+    size_t pos = 0;
+    while (pos <= str.size()) {
+        size_t pos_end = str.find(',', pos);
+        if (pos_end == std::string::npos) pos_end = str.size();
+        const std::string token = str.substr(pos, pos_end - pos);
+        const size_t pos_hyphen = token.find('-');
+        int32_t first = 0;
+        int32_t last = 0;
+        bool is_valid = false;
+        if (pos_hyphen == std::string::npos) {
+            is_valid = ParseCoreNumber(token, first);
+            last = first;
+        } else {
+            is_valid = ParseCoreNumber(token.substr(0, pos_hyphen), first) && ParseCoreNumber(token.substr(pos_hyphen + 1), last);
+        }
+        if (!is_valid || last < first || last >= GetCoreNum()) {
+            core_list.clear();
+            return kRetErr;
+        }
+        for (int32_t core = first; core <= last; core++) {
+            if (std::find(core_list.begin(), core_list.end(), core) == core_list.end()) core_list.push_back(core);
+        }
+        pos = pos_end + 1;
+    }
+    return kRetOk;
+}
+
+int32_t ThreadPlacement::GetCurrentThreadAffinity(std::vector<int32_t>& core_list)
+{
+    core_list.clear();
+#if defined(__linux__) || defined(__ANDROID__)
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    if (sched_getaffinity(0, sizeof(mask), &mask) != 0) return kRetErr;
+    for (int32_t i = 0; i < CPU_SETSIZE; i++) {
+        if (CPU_ISSET(i, &mask)) core_list.push_back(i);
+    }
+#elif defined(_WIN32)
+    /* There is no API to get the mask of a thread. A thread uses the process mask unless it's changed */
+    DWORD_PTR mask_process = 0;
+    DWORD_PTR mask_system = 0;
+    if (GetProcessAffinityMask(GetCurrentProcess(), &mask_process, &mask_system) == 0) return kRetErr;
+    for (int32_t i = 0; i < static_cast<int32_t>(sizeof(DWORD_PTR) * 8); i++) {
+        if ((mask_process >> i) & 1) core_list.push_back(i);
+    }
+#endif
+    return core_list.empty() ? kRetErr : kRetOk;
+}
+
+int32_t ThreadPlacement::SetCurrentThreadAffinity(const std::vector<int32_t>& core_list)
+{
+    if (core_list.empty()) return kRetErr;
+#if defined(__linux__) || defined(__ANDROID__)
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    for (const auto& core : core_list) CPU_SET(core, &mask);
+    /* pid = 0 means the calling thread */
+    if (sched_setaffinity(0, sizeof(mask), &mask) != 0) return kRetErr;
+    return kRetOk;
+#elif defined(_WIN32)
+    DWORD_PTR mask = 0;
+    for (const auto& core : core_list) {
+        if (core >= static_cast<int32_t>(sizeof(DWORD_PTR) * 8)) return kRetErr;
+        mask |= static_cast<DWORD_PTR>(1) << core;
+    }
+    if (SetThreadAffinityMask(GetCurrentThread(), mask) == 0) return kRetErr;
+    return kRetOk;
+#else
+    /* Not supported (e.g. macOS doesn't have API to pin a thread) */
+    return kRetErr;
+#endif
+}
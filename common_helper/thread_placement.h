@@ -0,0 +1,63 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef THREAD_PLACEMENT_
+#define THREAD_PLACEMENT_
+
+/* for general */
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <thread>
+
+/* Placement of inference threads (OpenMP worker threads used by the inference engine) on CPU cores */
+/* Each worker thread is pinned to one core, so that the scheduler doesn't migrate it between cores (and between big / little clusters) */
+/* The calling thread (OpenMP thread 0) is not pinned. GetOtherCoreList and SetCurrentThreadAffinity are for benchmark_affinity to emulate other threads */
+class ThreadPlacement {
+public:
+    enum {
+        kRetOk = 0,
+        kRetErr = -1,
+    };
+
+public:
+    ThreadPlacement();
+    ~ThreadPlacement() {}
+
+    /* affinity: "" (no pinning), "all", "big", "little", or core list (e.g. "4-7", "0,2,4") */
+    /* num_threads: 0 means the number of the cores (the number of all cores when not pinned) */
+    int32_t Initialize(const std::string& affinity, int32_t num_threads);
+    /* Pin the OpenMP worker threads of the calling thread. Call from the thread which runs inference. It does nothing after the first call on the same thread */
+    /* ImageProcessor calls it before the engine is created (so that warm-up runs on the pinned threads), and at each Process (in case Process runs on another thread) */
+    /* Pinning is disabled when it fails (e.g. not supported on the platform), and the threads already pinned are restored */
+    int32_t Apply();
+    int32_t GetThreadNum() const { return num_threads_; }
+    const std::vector<int32_t>& GetCoreList() const { return core_list_; }
+    std::vector<int32_t> GetOtherCoreList() const;
+
+    static int32_t GetCoreNum();
+    /* Big cores have the highest max frequency. All cores are big when frequency is the same or unknown */
+    static std::vector<int32_t> GetClusterCoreList(bool is_big);
+    static int32_t ParseCoreList(const std::string& str, std::vector<int32_t>& core_list);
+    static int32_t GetCurrentThreadAffinity(std::vector<int32_t>& core_list);
+    static int32_t SetCurrentThreadAffinity(const std::vector<int32_t>& core_list);
+
+private:
+    std::vector<int32_t> core_list_;    /* empty: no pinning */
+    int32_t num_threads_;
+    bool is_applied_;
+    std::thread::id applied_thread_id_;
+};
+
+#endif
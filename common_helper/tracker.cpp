@@ -21,12 +21,14 @@ limitations under the License.
 #include <list>
 #include <array>
 #include <memory>
+#include <algorithm>
+#include <functional>
 
 /* for My modules */
 #include "common_helper.h"
 #include "bounding_box.h"
 #include "tracker.h"
-#include "hungarian_algorithm.h"
+#include "assignment_solver.h"
 
 
 Track::Track(const int32_t id, const BoundingBox& bbox_det)
@@ -36,8 +38,6 @@ Track::Track(const int32_t id, const BoundingBox& bbox_det)
     data.bbox_raw = bbox_det;
     data_history_.push_back(data);
 
-    kf_ = CreateKalmanFilter_UniformLinearMotion(bbox_det);
-
     cnt_detected_ = 1;
     cnt_undetected_ = 0;
     id_ = id;
@@ -47,12 +47,9 @@ Track::~Track()
 {
 }
 
-BoundingBox Track::Predict()
+BoundingBox Track::Predict(const BoundingBox& bbox_pred)
 {
-    kf_.Predict();
-
     BoundingBox bbox = GetLatestBoundingBox();
-    BoundingBox bbox_pred = KalmanStatus2Bbox(kf_.X);   // w, y, w, h only
     bbox.w = bbox_pred.w;
     bbox.h = bbox_pred.h;
     bbox.x = bbox_pred.x;
@@ -62,25 +59,15 @@ BoundingBox Track::Predict()
     Data data;
     data.bbox = bbox;
     data.bbox_raw = bbox;
-    data_history_.push_back(data);
-    if (data_history_.size() > kMaxHistoryNum) {
-        data_history_.pop_front();
-    }
+    data_history_.push_back(data);     /* the oldest data is overwritten when the history is full */
 
     return bbox;
 }
 
-void Track::Update(const BoundingBox& bbox_det)
+void Track::Update(const BoundingBox& bbox_det, const BoundingBox& bbox_est)
 {
-    kf_.Update(Bbox2KalmanObserved(bbox_det));
-
-    Data data;
-    data.bbox = bbox_det;
-    data.bbox_raw = bbox_det;
-
     BoundingBox& bbox = data_history_.back().bbox;
     BoundingBox& bbox_raw = data_history_.back().bbox_raw;
-    BoundingBox bbox_est = KalmanStatus2Bbox(kf_.X);   // w, y, w, h only
     bbox_raw = bbox_det;
     bbox = bbox_det;
     bbox.w = bbox_est.w;
@@ -97,7 +84,7 @@ void Track::UpdateNoDetect()
     cnt_undetected_++;
 }
 
-std::deque<Track::Data>& Track::GetDataHistory()
+Track::DataHistory& Track::GetDataHistory()
 {
     return data_history_;
 }
@@ -128,13 +115,44 @@ const int32_t Track::GetDetectedCount() const
 }
 
 
-static constexpr int32_t kNumObserve = 4;   /* (cx, cy, area, aspect) */
-static constexpr int32_t kNumStatus = 7;    /* (cx, cy, area, aspect, vx, vy, vz)   (v = speed)*/
-KalmanFilter Track::CreateKalmanFilter_UniformLinearMotion(const BoundingBox& bbox_start)
+constexpr float Tracker::kCostMax;  // for link error in Android Studio (clang)
+constexpr double Tracker::kDtMax;
+Tracker::Tracker()
+{
+    track_sequence_num_ = 0;
+    threshold_frame_to_delete_ = 2;
+    threshold_iou_to_track_ = 0.3F;
+    frame_interval_ = 1.0 / 30;
+    timestamp_last_ = 0;
+    has_timestamp_ = false;
+    InitializeKalmanFilter_UniformLinearMotion();
+}
+
+Tracker::~Tracker()
+{
+}
+
+void Tracker::Reset()
+{
+    track_pool_.clear();
+    active_slot_list_.clear();
+    free_slot_list_.clear();
+    track_sequence_num_ = 0;
+    has_timestamp_ = false;
+}
+
+
+Tracker::TrackList Tracker::GetTrackList()
+{
+    return TrackList(track_pool_, active_slot_list_);
+}
+
+void Tracker::InitializeKalmanFilter_UniformLinearMotion()
 {
     /*** X(t) = F * X(t-1) + w(t) ***/
     /* Matrix to calculate X(t) from X(t-1). assume uniform motion: x(t) = x(t-1) + vt, v(t) = v(t-1) */
-    const SimpleMatrix F(kNumStatus, kNumStatus, {
+    /* This is for dt = 1 [frame]. F and Q are modified for each dt in PredictAll */
+    const KalmanFilter::MatrixStatus F({
         1, 0, 0, 0, 1, 0, 0,
         0, 1, 0, 0, 0, 1, 0,
         0, 0, 1, 0, 0, 0, 1,
@@ -146,7 +164,7 @@ KalmanFilter Track::CreateKalmanFilter_UniformLinearMotion(const BoundingBox& bb
 
 
     /* w(t), = noise, follows Q */
-    const SimpleMatrix Q(kNumStatus, kNumStatus, {
+    const KalmanFilter::MatrixStatus Q({
         1, 0, 0, 0,    0,    0,     0,
         0, 1, 0, 0,    0,    0,     0,
         0, 0, 1, 0,    0,    0,     0,
@@ -158,7 +176,7 @@ KalmanFilter Track::CreateKalmanFilter_UniformLinearMotion(const BoundingBox& bb
 
     /*** Z(t) = H * X(t) + v(t) ***/
     /* Matrix to calculate Z(observed value) from X(internal status) */
-    const SimpleMatrix H(kNumObserve, kNumStatus, {
+    const KalmanFilter::MatrixObserveStatus H({
         1, 0, 0, 0, 0, 0, 0,
         0, 1, 0, 0, 0, 0, 0,
         0, 0, 1, 0, 0, 0, 0,
@@ -166,35 +184,24 @@ KalmanFilter Track::CreateKalmanFilter_UniformLinearMotion(const BoundingBox& bb
         });
 
     /* v(t), = noise, follows R */
-    const SimpleMatrix R(kNumObserve, kNumObserve, {
+    const KalmanFilter::MatrixObserve R({
         1, 0,  0,  0,
         0, 1,  0,  0,
         0, 0, 10,  0,
         0, 0,  0, 10,
         });
 
-    /* First internal status */
-    SimpleMatrix P0 = SimpleMatrix::IdentityMatrix(kNumStatus);
-    P0 = P0 * 10;   /* Set big noise at first to make K=1 and trust observed value rather than estimated value */
-
-    const SimpleMatrix X0 = Bbox2KalmanStatus(bbox_start);
-
-    KalmanFilter kf;
-    kf.Initialize(
-        F,
-        Q,
-        H,
-        R,
-        X0,
-        P0
-    );
+    kf_.Initialize(F, Q, H, R);
+    Q_per_frame_ = Q;
 
-    return kf;
+    /* First internal status */
+    P0_ = KalmanFilter::MatrixStatus::IdentityMatrix();
+    for (int32_t i = 0; i < kNumStatus; i++) P0_(i, i) *= 10;   /* Set big noise at first to make K=1 and trust observed value rather than estimated value */
 }
 
-SimpleMatrix Track::Bbox2KalmanStatus(const BoundingBox& bbox)
+Tracker::KalmanFilter::VectorStatus Tracker::Bbox2KalmanStatus(const BoundingBox& bbox)
 {
-    SimpleMatrix X(kNumStatus, 1, {
+    KalmanFilter::VectorStatus X({
         static_cast<double>(bbox.x + bbox.w / 2),
         static_cast<double>(bbox.y + bbox.h / 2),
         static_cast<double>(bbox.w * bbox.h),
@@ -206,9 +213,9 @@ SimpleMatrix Track::Bbox2KalmanStatus(const BoundingBox& bbox)
     return X;
 }
 
-SimpleMatrix Track::Bbox2KalmanObserved(const BoundingBox& bbox)
+Tracker::KalmanFilter::VectorObserve Tracker::Bbox2KalmanObserved(const BoundingBox& bbox)
 {
-    SimpleMatrix Z(kNumObserve, 1, {
+    KalmanFilter::VectorObserve Z({
         static_cast<double>(bbox.x + bbox.w / 2),
         static_cast<double>(bbox.y + bbox.h / 2),
         static_cast<double>(bbox.w * bbox.h),
@@ -217,7 +224,7 @@ SimpleMatrix Track::Bbox2KalmanObserved(const BoundingBox& bbox)
     return Z;
 }
 
-BoundingBox Track::KalmanStatus2Bbox(const SimpleMatrix& X)
+BoundingBox Tracker::KalmanStatus2Bbox(const KalmanFilter::VectorStatus& X)
 {
     BoundingBox bbox;
     bbox.w = static_cast<int32_t>(std::sqrt(X(2, 0) * X(3, 0)));
@@ -228,31 +235,6 @@ BoundingBox Track::KalmanStatus2Bbox(const SimpleMatrix& X)
 }
 
 
-
-constexpr float Tracker::kCostMax;  // for link error in Android Studio (clang)
-Tracker::Tracker()
-{
-    track_sequence_num_ = 0;
-    threshold_frame_to_delete_ = 2;
-    threshold_iou_to_track_ = 0.3F;
-}
-
-Tracker::~Tracker()
-{
-}
-
-void Tracker::Reset()
-{
-    track_list_.clear();
-    track_sequence_num_ = 0;
-}
-
-
-std::vector<Track>& Tracker::GetTrackList()
-{
-    return track_list_;
-}
-
 float Tracker::CalculateSimilarity(const BoundingBox& bbox0, const BoundingBox& bbox1)
 {
     float iou = BoundingBoxUtils::CalculateIoU(bbox0, bbox1);
@@ -273,78 +255,315 @@ float Tracker::CalculateSimilarity(const BoundingBox& bbox0, const BoundingBox&
     return kCostMax - iou;
 }
 
-void Tracker::Update(const std::vector<BoundingBox>& det_list)
+/* Create (track, det) pairs whose cost is less than kCostMax. Only the pairs whose boxes are in the same grid cell are scored, because IoU is 0 for non overlapping boxes */
+void Tracker::CreateEdgeList(const std::vector<BoundingBox>& bbox_pred_list, const std::vector<BoundingBox>& det_list)
 {
-    /*** Predict the position at the current frame using the previous status for all tracked bbox ***/
-    std::vector<BoundingBox> bbox_pred_list;
-    for (auto& track : track_list_) {
-        BoundingBox bbox_prd = track.Predict();
-        bbox_pred_list.push_back(bbox_prd);
+    edge_list_.clear();
+    const int32_t num_track = static_cast<int32_t>(bbox_pred_list.size());
+    const int32_t num_det = static_cast<int32_t>(det_list.size());
+    if (num_track == 0 || num_det == 0) return;
+
+    /* Decide grid from the area covering all predicted boxes. Cell size is about the average box size */
+    int32_t x_min = bbox_pred_list[0].x;
+    int32_t y_min = bbox_pred_list[0].y;
+    int32_t x_max = bbox_pred_list[0].x + bbox_pred_list[0].w;
+    int32_t y_max = bbox_pred_list[0].y + bbox_pred_list[0].h;
+    int64_t size_sum = 0;
+    for (const auto& bbox : bbox_pred_list) {
+        x_min = (std::min)(x_min, bbox.x);
+        y_min = (std::min)(y_min, bbox.y);
+        x_max = (std::max)(x_max, bbox.x + bbox.w);
+        y_max = (std::max)(y_max, bbox.y + bbox.h);
+        size_sum += bbox.w + bbox.h;
+    }
+    int32_t cell_size = (std::max)(static_cast<int32_t>(size_sum / (2 * num_track)), 1);
+    cell_size = (std::max)(cell_size, (std::max)(x_max - x_min, y_max - y_min) / kGridMaxNum + 1);
+    const int32_t grid_w = (x_max - x_min) / cell_size + 1;
+    const int32_t grid_h = (y_max - y_min) / cell_size + 1;
+    const auto get_cell_range = [&](const BoundingBox& bbox, int32_t& gx0, int32_t& gy0, int32_t& gx1, int32_t& gy1) {
+        gx0 = (std::max)((bbox.x - x_min) / cell_size, 0);
+        gy0 = (std::max)((bbox.y - y_min) / cell_size, 0);
+        gx1 = (std::min)((bbox.x + bbox.w - x_min) / cell_size, grid_w - 1);
+        gy1 = (std::min)((bbox.y + bbox.h - y_min) / cell_size, grid_h - 1);
+        return bbox.x + bbox.w >= x_min && bbox.y + bbox.h >= y_min && bbox.x <= x_max && bbox.y <= y_max;
+    };
+
+    /* Put track index into each cell (counting sort, CSR layout) */
+    grid_cell_start_.assign(grid_w * grid_h + 1, 0);
+    int32_t gx0, gy0, gx1, gy1;
+    for (int32_t i_track = 0; i_track < num_track; i_track++) {
+        get_cell_range(bbox_pred_list[i_track], gx0, gy0, gx1, gy1);
+        for (int32_t gy = gy0; gy <= gy1; gy++) {
+            for (int32_t gx = gx0; gx <= gx1; gx++) grid_cell_start_[gy * grid_w + gx + 1]++;
+        }
+    }
+    for (int32_t i = 0; i < grid_w * grid_h; i++) grid_cell_start_[i + 1] += grid_cell_start_[i];
+    grid_track_index_.resize(grid_cell_start_.back());
+    grid_cell_fill_.assign(grid_cell_start_.begin(), grid_cell_start_.end() - 1);
+    for (int32_t i_track = 0; i_track < num_track; i_track++) {
+        get_cell_range(bbox_pred_list[i_track], gx0, gy0, gx1, gy1);
+        for (int32_t gy = gy0; gy <= gy1; gy++) {
+            for (int32_t gx = gx0; gx <= gx1; gx++) grid_track_index_[grid_cell_fill_[gy * grid_w + gx]++] = i_track;
+        }
     }
 
-    /*** Association ***/
-    /* Calculate IoU b/w predicted position and detected position */
-    size_t size_cost_matrix = (std::max)(track_list_.size(), det_list.size());  /* workaround: my hungarian algorithm sometimes outputs wrong result when the input matrix is not squared */
-    std::vector<std::vector<float>> cost_matrix(size_cost_matrix, std::vector<float>(size_cost_matrix, kCostMax));
-    for (size_t i_track = 0; i_track < track_list_.size(); i_track++) {
-        for (size_t i_det = 0; i_det < det_list.size(); i_det++) {
-            cost_matrix[i_track][i_det] = CalculateSimilarity(bbox_pred_list[i_track], det_list[i_det]);
+    /* Score tracks in the same cells as each det. A track in several cells is scored only once */
+    last_det_for_track_.assign(num_track, -1);
+    for (int32_t i_det = 0; i_det < num_det; i_det++) {
+        if (!get_cell_range(det_list[i_det], gx0, gy0, gx1, gy1)) continue;
+        for (int32_t gy = gy0; gy <= gy1; gy++) {
+            for (int32_t gx = gx0; gx <= gx1; gx++) {
+                const int32_t cell = gy * grid_w + gx;
+                for (int32_t i = grid_cell_start_[cell]; i < grid_cell_start_[cell + 1]; i++) {
+                    const int32_t i_track = grid_track_index_[i];
+                    if (last_det_for_track_[i_track] == i_det) continue;
+                    last_det_for_track_[i_track] = i_det;
+                    const float cost = CalculateSimilarity(bbox_pred_list[i_track], det_list[i_det]);
+                    if (cost < kCostMax) edge_list_.push_back({ i_track, i_det, cost, 0 });
+                }
+            }
         }
     }
+}
 
-    /* Assign track and det */
-    std::vector<int32_t> det_index_for_track(size_cost_matrix, -1);
-    std::vector<int32_t> track_index_for_det(size_cost_matrix, -1);
-    if (track_list_.size() > 0 && det_list.size() > 0) {
-        HungarianAlgorithm<float> solver(cost_matrix);
-        solver.Solve(det_index_for_track, track_index_for_det);
+/* Split (track, det) graph into connected components, and solve assignment for each component */
+void Tracker::SolveAssignment(int32_t num_track, int32_t num_det)
+{
+    det_index_for_track_.assign(num_track, -1);
+    track_index_for_det_.assign(num_det, -1);
+
+    /* Union-find. node: [0, num_track) = track, [num_track, num_track + num_det) = det */
+    union_parent_.resize(num_track + num_det);
+    for (int32_t i = 0; i < num_track + num_det; i++) union_parent_[i] = i;
+    const auto find_root = [&](int32_t node) {
+        while (union_parent_[node] != node) {
+            union_parent_[node] = union_parent_[union_parent_[node]];
+            node = union_parent_[node];
+        }
+        return node;
+    };
+    for (const auto& edge : edge_list_) {
+        int32_t root0 = find_root(edge.i_track);
+        int32_t root1 = find_root(num_track + edge.i_det);
+        if (root0 != root1) union_parent_[root1] = root0;
     }
+    for (auto& edge : edge_list_) edge.component = find_root(edge.i_track);
+    std::sort(edge_list_.begin(), edge_list_.end(), [](const Edge& lhs, const Edge& rhs) { return lhs.component < rhs.component; });
+
+    local_index_.assign(num_track + num_det, -1);
+    for (size_t begin = 0; begin < edge_list_.size();) {
+        size_t end = begin + 1;
+        while (end < edge_list_.size() && edge_list_[end].component == edge_list_[begin].component) end++;
+
+        if (end - begin == 1) {
+            /* Only one pair. No need to solve */
+            det_index_for_track_[edge_list_[begin].i_track] = edge_list_[begin].i_det;
+            track_index_for_det_[edge_list_[begin].i_det] = edge_list_[begin].i_track;
+            begin = end;
+            continue;
+        }
 
-#if 0
-    for (size_t i_track = 0; i_track < track_list_.size(); i_track++) {
-        for (size_t i_det = 0; i_det < det_list.size(); i_det++) {
-            printf("%.3f  ", cost_matrix[i_track][i_det]);
+        /* Small dense cost matrix for this component */
+        component_track_list_.clear();
+        component_det_list_.clear();
+        for (size_t i = begin; i < end; i++) {
+            const Edge& edge = edge_list_[i];
+            if (local_index_[edge.i_track] < 0) {
+                local_index_[edge.i_track] = static_cast<int32_t>(component_track_list_.size());
+                component_track_list_.push_back(edge.i_track);
+            }
+            if (local_index_[num_track + edge.i_det] < 0) {
+                local_index_[num_track + edge.i_det] = static_cast<int32_t>(component_det_list_.size());
+                component_det_list_.push_back(edge.i_det);
+            }
+        }
+        const int32_t rows = static_cast<int32_t>(component_track_list_.size());
+        const int32_t cols = static_cast<int32_t>(component_det_list_.size());
+        cost_matrix_.assign(rows * cols, kCostMax);
+        for (size_t i = begin; i < end; i++) {
+            const Edge& edge = edge_list_[i];
+            cost_matrix_[local_index_[edge.i_track] * cols + local_index_[num_track + edge.i_det]] = edge.cost;
+        }
+        assignment_solver_.Solve(cost_matrix_, rows, cols, local_assign_for_row_, local_assign_for_col_);
+        for (int32_t y = 0; y < rows; y++) {
+            const int32_t x = local_assign_for_row_[y];
+            if (x >= 0 && cost_matrix_[y * cols + x] < kCostMax) {
+                det_index_for_track_[component_track_list_[y]] = component_det_list_[x];
+                track_index_for_det_[component_det_list_[x]] = component_track_list_[y];
+            }
         }
-        printf("\n");
+
+        for (int32_t i_track : component_track_list_) local_index_[i_track] = -1;
+        for (int32_t i_det : component_det_list_) local_index_[num_track + i_det] = -1;
+        begin = end;
     }
+}
 
-    printf("track:  det\n");
-    for (size_t i = 0; i < det_index_for_track.size(); i++) {
-        printf("%3d:  %3d\n", i, det_index_for_track[i]);
+void Tracker::PredictAll(double dt)
+{
+    /* Motion model for dt [frame]. v [pixel/frame] is kept, and noise grows in proportion to dt */
+    kf_.F(0, 4) = dt;
+    kf_.F(1, 5) = dt;
+    kf_.F(2, 6) = dt;
+    for (int32_t i = 0; i < kNumStatus * kNumStatus; i++) kf_.Q.data_array[i] = Q_per_frame_.data_array[i] * dt;
+
+    /* Free slots are reused from the lowest one, so active slots are packed in [0, max active slot] */
+    int32_t num_live = 0;
+    for (int32_t slot : active_slot_list_) num_live = (std::max)(num_live, slot + 1);
+    kf_.Predict(num_live);
+    bbox_pred_list_.clear();
+    KalmanFilter::VectorStatus X;
+    for (int32_t slot : active_slot_list_) {
+        kf_.GetStatus(slot, X);
+        bbox_pred_list_.push_back(track_pool_[slot].Predict(KalmanStatus2Bbox(X)));
     }
-    printf("det:  track\n");
-    for (size_t i = 0; i < track_index_for_det.size(); i++) {
-        printf("%3d:  %3d\n", i, track_index_for_det[i]);
+}
+
+/* Convert timestamp [sec] to elapsed frames from the previous call */
+double Tracker::CalculateDt(double timestamp)
+{
+    double dt = PeekDt(timestamp);
+    timestamp_last_ = timestamp;
+    has_timestamp_ = true;
+    return dt;
+}
+
+double Tracker::PeekDt(double timestamp) const
+{
+    double dt = has_timestamp_ ? (timestamp - timestamp_last_) / frame_interval_ : 1.0;
+    return (std::min)((std::max)(dt, 0.0), kDtMax);
+}
+
+/* X = F * X for dt without changing the status. P is not needed for the position */
+void Tracker::PredictBoundingBoxList(double dt, std::vector<BoundingBox>& bbox_list) const
+{
+    KalmanFilter::MatrixStatus F = kf_.F;
+    F(0, 4) = dt;
+    F(1, 5) = dt;
+    F(2, 6) = dt;
+    bbox_list.clear();
+    KalmanFilter::VectorStatus X;
+    KalmanFilter::VectorStatus X_pred;
+    for (int32_t slot : active_slot_list_) {
+        kf_.GetStatus(slot, X);
+        FixedMatrixUtils::Multiply(X_pred, F, X);
+        BoundingBox bbox = track_pool_[slot].GetLatestBoundingBox();
+        const BoundingBox bbox_pred = KalmanStatus2Bbox(X_pred);
+        bbox.x = bbox_pred.x;
+        bbox.y = bbox_pred.y;
+        bbox.w = bbox_pred.w;
+        bbox.h = bbox_pred.h;
+        bbox_list.push_back(bbox);
     }
-#endif
+}
+
+void Tracker::GetPredictedBoundingBoxList(std::vector<BoundingBox>& bbox_list) const
+{
+    PredictBoundingBoxList(1.0, bbox_list);
+}
+
+void Tracker::GetPredictedBoundingBoxList(double timestamp, std::vector<BoundingBox>& bbox_list) const
+{
+    PredictBoundingBoxList(PeekDt(timestamp), bbox_list);
+}
+
+void Tracker::Predict()
+{
+    /*** Only predict the position at the current frame. Tracks are neither updated nor deleted ***/
+    if (has_timestamp_) timestamp_last_ += frame_interval_;
+    PredictAll(1.0);
+}
+
+void Tracker::Predict(double timestamp)
+{
+    PredictAll(CalculateDt(timestamp));
+}
+
+void Tracker::Update(const std::vector<BoundingBox>& det_list)
+{
+    if (has_timestamp_) timestamp_last_ += frame_interval_;
+    UpdateImpl(det_list, 1.0);
+}
+
+void Tracker::Update(const std::vector<BoundingBox>& det_list, double timestamp)
+{
+    UpdateImpl(det_list, CalculateDt(timestamp));
+}
+
+void Tracker::UpdateImpl(const std::vector<BoundingBox>& det_list, double dt)
+{
+    /*** Predict the position at the current frame using the previous status for all tracked bbox ***/
+    PredictAll(dt);
+    KalmanFilter::VectorStatus X;
+
+    /*** Association ***/
+    /* Calculate IoU b/w predicted position and detected position, only for overlapping pairs */
+    const int32_t num_track = static_cast<int32_t>(active_slot_list_.size());
+    const int32_t num_det = static_cast<int32_t>(det_list.size());
+    CreateEdgeList(bbox_pred_list_, det_list);
+
+    /* Assign track and det */
+    SolveAssignment(num_track, num_det);
 
     /*** Update track ***/
-    std::vector<bool> is_det_assigned_list(size_cost_matrix, false);
-    for (size_t i_track = 0; i_track < track_list_.size(); i_track++) {
-        int32_t assigned_det_index = det_index_for_track[i_track];
-        if (assigned_det_index >= 0 && assigned_det_index < static_cast<int32_t>(det_list.size()) && cost_matrix[i_track][assigned_det_index] < kCostMax) {
-            track_list_[i_track].Update(det_list[assigned_det_index]);
-            is_det_assigned_list[assigned_det_index] = true;
+    /* Kalman filter of all the matched tracks is updated at once */
+    update_slot_list_.clear();
+    update_observe_list_.clear();
+    for (int32_t i_track = 0; i_track < num_track; i_track++) {
+        int32_t assigned_det_index = det_index_for_track_[i_track];
+        if (assigned_det_index >= 0) {
+            update_slot_list_.push_back(active_slot_list_[i_track]);
+            update_observe_list_.push_back(Bbox2KalmanObserved(det_list[assigned_det_index]));
+        }
+    }
+    kf_.Update(update_slot_list_.data(), update_observe_list_.data(), static_cast<int32_t>(update_slot_list_.size()));
+    for (int32_t i_track = 0; i_track < num_track; i_track++) {
+        int32_t assigned_det_index = det_index_for_track_[i_track];
+        if (assigned_det_index >= 0) {
+            const int32_t slot = active_slot_list_[i_track];
+            kf_.GetStatus(slot, X);
+            track_pool_[slot].Update(det_list[assigned_det_index], KalmanStatus2Bbox(X));
         } else{
-            track_list_[i_track].UpdateNoDetect();
+            track_pool_[active_slot_list_[i_track]].UpdateNoDetect();
         }
     }
 
     /*** Delete tracks ***/
-    for (auto it = track_list_.begin(); it != track_list_.end();) {
-        if (it->GetUndetectedCount() >= threshold_frame_to_delete_) {
-            it = track_list_.erase(it);
+    /* Return the slot to the free list. Other tracks are not moved */
+    size_t num_active = 0;
+    for (int32_t slot : active_slot_list_) {
+        if (track_pool_[slot].GetUndetectedCount() >= threshold_frame_to_delete_) {
+            free_slot_list_.push_back(slot);
+            std::push_heap(free_slot_list_.begin(), free_slot_list_.end(), std::greater<int32_t>());
         } else {
-            it++;
+            active_slot_list_[num_active++] = slot;
         }
     }
+    active_slot_list_.resize(num_active);
 
     /*** Add new tracks ***/
     for (size_t i = 0; i < det_list.size(); i++) {
-        if (is_det_assigned_list[i] == false) {
-            track_list_.push_back(Track(track_sequence_num_, det_list[i]));
-            track_sequence_num_++;
+        if (track_index_for_det_[i] < 0) {
+            AddTrack(det_list[i]);
         }
     }
 }
 
+void Tracker::AddTrack(const BoundingBox& bbox_det)
+{
+    int32_t slot;
+    if (free_slot_list_.empty()) {
+        slot = static_cast<int32_t>(track_pool_.size());
+        track_pool_.push_back(Track(track_sequence_num_, bbox_det));
+        kf_.Reserve(slot + 1);
+    } else {
+        /* free_slot_list_ is a min-heap */
+        std::pop_heap(free_slot_list_.begin(), free_slot_list_.end(), std::greater<int32_t>());
+        slot = free_slot_list_.back();
+        free_slot_list_.pop_back();
+        track_pool_[slot] = Track(track_sequence_num_, bbox_det);
+    }
+    kf_.SetStatus(slot, Bbox2KalmanStatus(bbox_det), P0_);
+    active_slot_list_.push_back(slot);
+    track_sequence_num_++;
+}
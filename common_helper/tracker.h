@@ -27,7 +27,9 @@ limitations under the License.
 
 /* for My modules */
 #include "bounding_box.h"
-#include "kalman_filter.h"
+#include "ring_buffer.h"
+#include "kalman_filter_batch.h"
+#include "assignment_solver.h"
 
 
 class Track {
@@ -39,16 +41,18 @@ public:
         BoundingBox bbox;
         BoundingBox bbox_raw;
     } Data;
+    typedef RingBuffer<Data, kMaxHistoryNum> DataHistory;
 
 public:
     Track(const int32_t id, const BoundingBox& bbox_det);
     ~Track();
 
-    BoundingBox Predict();
-    void Update(const BoundingBox& bbox_det);
+    /* Position is estimated by Tracker (Kalman filter for all tracks is held in Tracker) */
+    BoundingBox Predict(const BoundingBox& bbox_pred);
+    void Update(const BoundingBox& bbox_det, const BoundingBox& bbox_est);
     void UpdateNoDetect();
 
-    std::deque<Data>& GetDataHistory();
+    DataHistory& GetDataHistory();
     const Data& GetLatestData() const ;
     const BoundingBox& GetLatestBoundingBox() const;
 
@@ -57,14 +61,7 @@ public:
     const int32_t GetDetectedCount() const;
 
 private:
-    KalmanFilter CreateKalmanFilter_UniformLinearMotion(const BoundingBox& bbox_start);
-    SimpleMatrix Bbox2KalmanObserved(const BoundingBox& bbox);
-    SimpleMatrix Bbox2KalmanStatus(const BoundingBox& bbox);
-    BoundingBox KalmanStatus2Bbox(const SimpleMatrix& X);
-
-private:
-    std::deque<Data> data_history_;
-    KalmanFilter kf_;
+    DataHistory data_history_;
     int32_t id_;
     int32_t cnt_detected_;
     int32_t cnt_undetected_;
@@ -74,23 +71,118 @@ private:
 class Tracker {
 private:
     static constexpr float kCostMax = 1.0F;
+    static constexpr int32_t kGridMaxNum = 64;  /* max number of grid cells in each direction for gating */
+    static constexpr double kDtMax = 30.0;      /* [frame] elapsed time longer than this is clipped */
+    static constexpr int32_t kNumObserve = 4;   /* (cx, cy, area, aspect) */
+    static constexpr int32_t kNumStatus = 7;    /* (cx, cy, area, aspect, vx, vy, vz)   (v = speed)*/
+    typedef KalmanFilterBatch<kNumStatus, kNumObserve> KalmanFilter;
+
+    typedef struct Edge_ {
+        int32_t i_track;
+        int32_t i_det;
+        float   cost;
+        int32_t component;
+    } Edge;
+
+public:
+    /* View of active tracks in the pool (in the order of creation). Can be used in range-based for */
+    class TrackList {
+    public:
+        class Iterator {
+        public:
+            Iterator(std::vector<Track>& pool, const int32_t* slot) : pool_(pool), slot_(slot) {}
+            Track& operator*() const { return pool_[*slot_]; }
+            Track* operator->() const { return &pool_[*slot_]; }
+            Iterator& operator++() { slot_++; return *this; }
+            bool operator!=(const Iterator& rhs) const { return slot_ != rhs.slot_; }
+        private:
+            std::vector<Track>& pool_;
+            const int32_t* slot_;
+        };
+
+        TrackList(std::vector<Track>& pool, const std::vector<int32_t>& slot_list) : pool_(pool), slot_list_(slot_list) {}
+        Iterator begin() const { return Iterator(pool_, slot_list_.data()); }
+        Iterator end() const { return Iterator(pool_, slot_list_.data() + slot_list_.size()); }
+        size_t size() const { return slot_list_.size(); }
+        Track& operator[] (size_t i) const { return pool_[slot_list_[i]]; }
+
+    private:
+        std::vector<Track>& pool_;
+        const std::vector<int32_t>& slot_list_;
+    };
 
 public:
     Tracker();
     ~Tracker();
     void Reset();
 
+    /* Without timestamp, the time b/w calls is regarded as 1 frame */
     void Update(const std::vector<BoundingBox>& det_list);
+    void Predict();     /* for frames without detection */
 
-    std::vector<Track>& GetTrackList();
+    /* With timestamp [sec], the motion model uses the elapsed time, so dropped or skipped frames are handled */
+    void Update(const std::vector<BoundingBox>& det_list, double timestamp);
+    void Predict(double timestamp);
+    void SetFrameInterval(double frame_interval) { frame_interval_ = frame_interval; }   /* [sec] the time regarded as 1 frame */
+
+    TrackList GetTrackList();
+
+    /* Position of each track (in the order of GetTrackList) at the next frame / timestamp. The status is not changed (e.g. to decide ROI before detection) */
+    void GetPredictedBoundingBoxList(std::vector<BoundingBox>& bbox_list) const;
+    void GetPredictedBoundingBoxList(double timestamp, std::vector<BoundingBox>& bbox_list) const;
 
 private:
     float CalculateSimilarity(const BoundingBox& bbox0, const BoundingBox& bbox1);
+    void InitializeKalmanFilter_UniformLinearMotion();
+    void PredictAll(double dt);
+    void UpdateImpl(const std::vector<BoundingBox>& det_list, double dt);
+    double CalculateDt(double timestamp);
+    double PeekDt(double timestamp) const;
+    void PredictBoundingBoxList(double dt, std::vector<BoundingBox>& bbox_list) const;
+    void AddTrack(const BoundingBox& bbox_det);
+    static KalmanFilter::VectorObserve Bbox2KalmanObserved(const BoundingBox& bbox);
+    static KalmanFilter::VectorStatus Bbox2KalmanStatus(const BoundingBox& bbox);
+    static BoundingBox KalmanStatus2Bbox(const KalmanFilter::VectorStatus& X);
+    void CreateEdgeList(const std::vector<BoundingBox>& bbox_pred_list, const std::vector<BoundingBox>& det_list);
+    void SolveAssignment(int32_t num_track, int32_t num_det);
 
 private:
-    std::vector<Track> track_list_;
+    /* Track pool. A slot keeps its index while the track is alive, and the slot is reused after the track is deleted */
+    std::vector<Track> track_pool_;
+    std::vector<int32_t> active_slot_list_;
+    std::vector<int32_t> free_slot_list_;     /* min-heap, so that the lowest slot is reused first */
     int32_t track_sequence_num_;
 
+    /* Status of all tracks (indexed by slot) with shared F, Q, H, R */
+    KalmanFilter kf_;
+    KalmanFilter::MatrixStatus P0_;
+    KalmanFilter::MatrixStatus Q_per_frame_;
+
+    /* Time [sec] */
+    double frame_interval_;
+    double timestamp_last_;
+    bool has_timestamp_;
+
+    /* Work buffers for association */
+    std::vector<BoundingBox> bbox_pred_list_;
+    std::vector<int32_t> grid_cell_start_;      /* track indices in cell i are grid_track_index_[grid_cell_start_[i]:grid_cell_start_[i + 1]] */
+    std::vector<int32_t> grid_cell_fill_;
+    std::vector<int32_t> grid_track_index_;
+    std::vector<int32_t> last_det_for_track_;
+    std::vector<Edge> edge_list_;
+    std::vector<int32_t> union_parent_;
+    std::vector<int32_t> local_index_;
+    std::vector<int32_t> component_track_list_;
+    std::vector<int32_t> component_det_list_;
+    std::vector<float> cost_matrix_;
+    std::vector<int32_t> local_assign_for_row_;
+    std::vector<int32_t> local_assign_for_col_;
+    std::vector<int32_t> det_index_for_track_;
+    std::vector<int32_t> track_index_for_det_;
+    std::vector<int32_t> update_slot_list_;
+    std::vector<KalmanFilter::VectorObserve> update_observe_list_;
+    AssignmentSolver<float> assignment_solver_;
+
     int32_t threshold_frame_to_delete_;
     float threshold_iou_to_track_;
 };
@@ -19,6 +19,7 @@
 #include "common_helper_cv.h"
 #include "inference_helper.h"
 #include "inference_helper_tensorrt.h"      // to call SetDlaCore
+#include "model_bundle.h"
 #include "anime_to_sketch_engine.h"
 
 /*** Macro ***/
@@ -34,12 +35,21 @@
 #define IS_NCHW       true
 #define IS_RGB        true
 #define OUTPUT_NAME  "110"
+#define BUNDLE_NAME  "anime2sketch_512x512.bundle"     /* model information in the bundle is used instead of the values above if exists */
 
 /*** Function ***/
-int32_t Anime2SketchEngine::Initialize(const std::string& work_dir, const int32_t num_threads)
+int32_t Anime2SketchEngine::Initialize(const std::string& work_dir, const int32_t num_threads, const int32_t num_warmup)
 {
     /* Set model information */
     std::string model_filename = work_dir + "/model/" + MODEL_NAME;
+    ModelBundle bundle;
+    const std::string bundle_filename = work_dir + "/model/" + BUNDLE_NAME;
+    if (std::ifstream(bundle_filename).good()) {
+        if (bundle.Open(bundle_filename) != ModelBundle::kRetOk) {
+            return kRetErr;
+        }
+        model_filename = work_dir + "/model/" + bundle.GetMeta("model_file", MODEL_NAME);
+    }
 
     /* Set input tensor info */
     input_tensor_info_list_.clear();
@@ -52,11 +62,18 @@ int32_t Anime2SketchEngine::Initialize(const std::string& work_dir, const int32_
     input_tensor_info.normalize.norm[0] = 0.5f;
     input_tensor_info.normalize.norm[1] = 0.5f;
     input_tensor_info.normalize.norm[2] = 0.5f;
+    is_rgb_ = IS_RGB;
+    std::vector<std::string> output_name_list = { OUTPUT_NAME };
+    if (bundle.IsOpened() && bundle.GetModelInfo(input_tensor_info.name, input_tensor_info.tensor_dims, input_tensor_info.normalize.mean, input_tensor_info.normalize.norm, is_rgb_, output_name_list) != ModelBundle::kRetOk) {
+        return kRetErr;
+    }
     input_tensor_info_list_.push_back(input_tensor_info);
 
     /* Set output tensor info */
     output_tensor_info_list_.clear();
-    output_tensor_info_list_.push_back(OutputTensorInfo(OUTPUT_NAME, TENSORTYPE));
+    for (const auto& output_name : output_name_list) {
+        output_tensor_info_list_.push_back(OutputTensorInfo(output_name, TENSORTYPE));
+    }
 
     /* Create and Initialize Inference Helper */
     inference_helper_.reset(InferenceHelper::Create(InferenceHelper::kNcnn));
@@ -74,6 +91,22 @@ int32_t Anime2SketchEngine::Initialize(const std::string& work_dir, const int32_
         return kRetErr;
     }
 
+    if (Warmup(num_warmup) != kRetOk) {
+        PRINT_E("Warm-up failed\n");
+        return kRetErr;
+    }
+
+    return kRetOk;
+}
+
+int32_t Anime2SketchEngine::Warmup(int32_t num_warmup)
+{
+    InputTensorInfo& input_tensor_info = input_tensor_info_list_[0];
+    cv::Mat img_src = cv::Mat::zeros(input_tensor_info.GetHeight(), input_tensor_info.GetWidth(), CV_8UC3);
+    Result result;
+    if (!CommonHelper::Warmup(num_warmup, [&]() { return Process(img_src, result) == kRetOk; })) {
+        return kRetErr;
+    }
     return kRetOk;
 }
 
@@ -102,10 +135,12 @@ int32_t Anime2SketchEngine::Process(const cv::Mat& original_mat, Result& result)
     int32_t crop_y = 0;
     int32_t crop_w = original_mat.cols;
     int32_t crop_h = original_mat.rows;
-    cv::Mat img_src = cv::Mat::zeros(input_tensor_info.GetHeight(), input_tensor_info.GetWidth(), CV_8UC3);
+    img_src_.create(input_tensor_info.GetHeight(), input_tensor_info.GetWidth(), CV_8UC3);
+    img_src_.setTo(cv::Scalar(0, 0, 0));
+    cv::Mat& img_src = img_src_;
     //CommonHelper::CropResizeCvt(original_mat, img_src, crop_x, crop_y, crop_w, crop_h, IS_RGB, CommonHelper::kCropTypeStretch);
     //CommonHelper::CropResizeCvt(original_mat, img_src, crop_x, crop_y, crop_w, crop_h, IS_RGB, CommonHelper::kCropTypeCut);
-    CommonHelper::CropResizeCvt(original_mat, img_src, crop_x, crop_y, crop_w, crop_h, IS_RGB, CommonHelper::kCropTypeExpand);
+    CommonHelper::CropResizeCvt(original_mat, img_src, crop_x, crop_y, crop_w, crop_h, is_rgb_, CommonHelper::kCropTypeExpand);
 
     input_tensor_info.data = img_src.data;
     input_tensor_info.data_type = InputTensorInfo::kDataTypeImage;
@@ -133,13 +168,16 @@ int32_t Anime2SketchEngine::Process(const cv::Mat& original_mat, Result& result)
 
     /*** PostProcess ***/
     const auto& t_post_process0 = std::chrono::steady_clock::now();
-    cv::Mat outmat_fp(cv::Size(output_tensor_info_list_[0].tensor_dims[3], output_tensor_info_list_[0].tensor_dims[2]), CV_32FC1, const_cast<float*>(output_tensor_info_list_[0].GetDataAsFloat()));
-    cv::Mat out_mat;
-    outmat_fp.convertTo(out_mat, CV_8UC1, 128);
+    /* note: pixels of original_mat must not be read from here because result.image may share the same buffer */
+    int32_t original_w = original_mat.cols;
+    int32_t original_h = original_mat.rows;
+    if (result.image.rows != original_h || result.image.cols != original_w || (result.image.type() != CV_8UC1 && result.image.type() != CV_8UC3)) {
+        result.image.create(original_h, original_w, CV_8UC1);
+    }
+    ConvertOutput(output_tensor_info_list_[0].GetDataAsFloat(), output_tensor_info_list_[0].tensor_dims[3], output_tensor_info_list_[0].tensor_dims[2], crop_x, crop_y, crop_w, crop_h, result.image);
     const auto& t_post_process1 = std::chrono::steady_clock::now();
 
     /* Return the results */
-    result.image = out_mat;
     result.time_pre_process = static_cast<std::chrono::duration<double>>(t_pre_process1 - t_pre_process0).count() * 1000.0;
     result.time_inference = static_cast<std::chrono::duration<double>>(t_inference1 - t_inference0).count() * 1000.0;
     result.time_post_process = static_cast<std::chrono::duration<double>>(t_post_process1 - t_post_process0).count() * 1000.0;;
@@ -147,3 +185,52 @@ int32_t Anime2SketchEngine::Process(const cv::Mat& original_mat, Result& result)
     return kRetOk;
 }
 
+
+/* Convert the model output (float) to 8bit image in the original image size */
+/* Scale (x128), saturation, resize (bilinear) and removing the letterbox are done in one pass without intermediate image */
+/* (crop_x, crop_y, crop_w, crop_h) is the area in the original image coordinate which corresponds to the whole model input */
+void Anime2SketchEngine::ConvertOutput(const float* src, int32_t src_w, int32_t src_h, int32_t crop_x, int32_t crop_y, int32_t crop_w, int32_t crop_h, cv::Mat& dst)
+{
+    static constexpr float kScale = 128.0f;
+    const float ratio_x = static_cast<float>(src_w) / crop_w;
+    const float ratio_y = static_cast<float>(src_h) / crop_h;
+    const int32_t channel = dst.channels();
+
+    /* Position in the source for each column */
+    x_index_list_.resize(dst.cols);
+    x_weight_list_.resize(dst.cols);
+    for (int32_t x = 0; x < dst.cols; x++) {
+        float src_x = (x - crop_x + 0.5f) * ratio_x - 0.5f;
+        src_x = (std::min)((std::max)(src_x, 0.0f), static_cast<float>(src_w - 1));
+        int32_t x0 = (std::min)(static_cast<int32_t>(src_x), src_w - 2);
+        x_index_list_[x] = x0;
+        x_weight_list_[x] = src_x - x0;
+    }
+
+    row_buffer_.resize(src_w);
+    float* row = row_buffer_.data();
+    for (int32_t y = 0; y < dst.rows; y++) {
+        float src_y = (y - crop_y + 0.5f) * ratio_y - 0.5f;
+        src_y = (std::min)((std::max)(src_y, 0.0f), static_cast<float>(src_h - 1));
+        int32_t y0 = (std::min)(static_cast<int32_t>(src_y), src_h - 2);
+        float wy = src_y - y0;
+
+        /* Interpolate vertically first, then horizontally */
+        const float* src_row0 = src + y0 * src_w;
+        const float* src_row1 = src_row0 + src_w;
+#pragma omp simd
+        for (int32_t x = 0; x < src_w; x++) {
+            row[x] = (src_row0[x] + (src_row1[x] - src_row0[x]) * wy) * kScale;
+        }
+
+        uint8_t* dst_row = dst.ptr<uint8_t>(y);
+        for (int32_t x = 0; x < dst.cols; x++) {
+            int32_t x0 = x_index_list_[x];
+            float val = row[x0] + (row[x0 + 1] - row[x0]) * x_weight_list_[x] + 0.5f;
+            uint8_t val_u8 = static_cast<uint8_t>((std::min)((std::max)(val, 0.0f), 255.0f));
+            for (int32_t c = 0; c < channel; c++) {
+                dst_row[x * channel + c] = val_u8;
+            }
+        }
+    }
+}
@@ -24,7 +24,7 @@ public:
     };
 
     typedef struct Result_ {
-        cv::Mat           image;
+        cv::Mat           image;                /* sketch in the original image size. If image is already allocated with the original size (CV_8UC1 or CV_8UC3), it is overwritten without allocation */
         double            time_pre_process;		// [msec]
         double            time_inference;		// [msec]
         double            time_post_process;	// [msec]
@@ -33,17 +33,28 @@ public:
     } Result;
 
 public:
-    Anime2SketchEngine() {}
+    Anime2SketchEngine() : is_rgb_(true) {}
     ~Anime2SketchEngine() {}
-    int32_t Initialize(const std::string& work_dir, const int32_t num_threads);
+    int32_t Initialize(const std::string& work_dir, const int32_t num_threads, const int32_t num_warmup = 0);
     int32_t Finalize(void);
     int32_t Process(const cv::Mat& original_mat, Result& result);
 
 
+private:
+    int32_t Warmup(int32_t num_warmup);
+    void ConvertOutput(const float* src, int32_t src_w, int32_t src_h, int32_t crop_x, int32_t crop_y, int32_t crop_w, int32_t crop_h, cv::Mat& dst);
+
 private:
     std::unique_ptr<InferenceHelper> inference_helper_;
     std::vector<InputTensorInfo> input_tensor_info_list_;
     std::vector<OutputTensorInfo> output_tensor_info_list_;
+    bool is_rgb_;
+
+    /* work buffers reused for each frame to avoid allocation */
+    cv::Mat img_src_;
+    std::vector<int32_t> x_index_list_;
+    std::vector<float> x_weight_list_;
+    std::vector<float> row_buffer_;
 };
 
 #endif
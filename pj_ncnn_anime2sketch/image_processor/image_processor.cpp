@@ -18,6 +18,7 @@
 /* for My modules */
 #include "common_helper.h"
 #include "common_helper_cv.h"
+#include "thread_placement.h"
 #include "anime_to_sketch_engine.h"
 #include "image_processor.h"
 
@@ -28,6 +29,7 @@
 
 /*** Global variable ***/
 std::unique_ptr<Anime2SketchEngine> s_engine;
+ThreadPlacement s_thread_placement;
 
 /*** Function ***/
 static void DrawFps(cv::Mat& mat, double time_inference, cv::Point pos, double font_scale, int32_t thickness, cv::Scalar color_front, cv::Scalar color_back, bool is_text_on_rect = true)
@@ -48,8 +50,13 @@ int32_t ImageProcessor::Initialize(const InputParam& input_param)
         return -1;
     }
 
+    if (s_thread_placement.Initialize(input_param.cpu_affinity, input_param.num_threads) != ThreadPlacement::kRetOk) {
+        return -1;
+    }
+    s_thread_placement.Apply();
+
     s_engine.reset(new Anime2SketchEngine());
-    if (s_engine->Initialize(input_param.work_dir, input_param.num_threads) != Anime2SketchEngine::kRetOk) {
+    if (s_engine->Initialize(input_param.work_dir, s_thread_placement.GetThreadNum(), input_param.num_warmup) != Anime2SketchEngine::kRetOk) {
         s_engine->Finalize();
         s_engine.reset();
         return -1;
@@ -94,14 +101,27 @@ int32_t ImageProcessor::Process(cv::Mat& mat, Result& result)
         PRINT_E("Not initialized\n");
         return -1;
     }
+    s_thread_placement.Apply();
 
+    /* Write the sketch into the input image directly (the input image is not used after pre-process) */
     Anime2SketchEngine::Result style_transfer_result;
-    s_engine->Process(mat, style_transfer_result);
+    style_transfer_result.image = mat;
+    if (s_engine->Process(mat, style_transfer_result) != Anime2SketchEngine::kRetOk) {
+        return -1;
+    }
+    if (style_transfer_result.image.data != mat.data) {
+        /* The engine allocated a new image because the input type can't hold the sketch (e.g. RGBA frame on Android) */
+        if (mat.type() == CV_8UC4) {
+            /* Convert into the caller's buffer so that the caller's frame is updated */
+            cv::cvtColor(style_transfer_result.image, mat, (style_transfer_result.image.channels() == 1) ? cv::COLOR_GRAY2BGRA : cv::COLOR_BGR2BGRA);
+        } else {
+            mat = style_transfer_result.image;
+        }
+    }
 
     DrawFps(mat, style_transfer_result.time_inference, cv::Point(0, 0), 0.5, 2, CommonHelper::CreateCvColor(0, 0, 0), CommonHelper::CreateCvColor(180, 180, 180), true);
 
     /* Return the results */
-    mat = style_transfer_result.image;
     result.time_pre_process = style_transfer_result.time_pre_process;
     result.time_inference = style_transfer_result.time_inference;
     result.time_post_process = style_transfer_result.time_post_process;
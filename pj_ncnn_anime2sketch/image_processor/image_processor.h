@@ -17,7 +17,9 @@ namespace ImageProcessor
 
 typedef struct {
     char     work_dir[256];
-    int32_t  num_threads;
+    int32_t  num_threads;       /* 0: the number of cores in cpu_affinity (all cores when not pinned) */
+    int32_t  num_warmup;        /* number of dummy inferences in Initialize (0: no warm-up) */
+    char     cpu_affinity[32];  /* Pin inference threads to cores. "": not pinned, "all", "big", "little", or core list (e.g. "4-7") */
 } InputParam;
 
 typedef struct {
@@ -18,6 +18,7 @@
 #include "common_helper.h"
 #include "common_helper_cv.h"
 #include "inference_helper.h"
+#include "model_bundle.h"
 #include "classification_engine.h"
 
 /*** Macro ***/
@@ -35,13 +36,22 @@
 #define OUTPUT_NAME  "mobilenetv20_output_flatten0_reshape0"
 
 #define LABEL_NAME   "imagenet_labels.txt"
+#define BUNDLE_NAME  "mobilenetv2-1.0.bundle"     /* model information in the bundle is used instead of the values above if exists */
 
 /*** Function ***/
-int32_t ClassificationEngine::Initialize(const std::string& work_dir, const int32_t num_threads)
+int32_t ClassificationEngine::Initialize(const std::string& work_dir, const int32_t num_threads, const int32_t num_warmup)
 {
     /* Set model information */
     std::string model_filename = work_dir + "/model/" + MODEL_NAME;
     std::string label_filename = work_dir + "/model/" + LABEL_NAME;
+    ModelBundle bundle;
+    const std::string bundle_filename = work_dir + "/model/" + BUNDLE_NAME;
+    if (std::ifstream(bundle_filename).good()) {
+        if (bundle.Open(bundle_filename) != ModelBundle::kRetOk) {
+            return kRetErr;
+        }
+        model_filename = work_dir + "/model/" + bundle.GetMeta("model_file", MODEL_NAME);
+    }
 
     /* Set input tensor info */
     input_tensor_info_list_.clear();
@@ -54,11 +64,18 @@ int32_t ClassificationEngine::Initialize(const std::string& work_dir, const int3
     input_tensor_info.normalize.norm[0] = 0.229f;
     input_tensor_info.normalize.norm[1] = 0.224f;
     input_tensor_info.normalize.norm[2] = 0.225f;
+    is_rgb_ = IS_RGB;
+    std::vector<std::string> output_name_list = { OUTPUT_NAME };
+    if (bundle.IsOpened() && bundle.GetModelInfo(input_tensor_info.name, input_tensor_info.tensor_dims, input_tensor_info.normalize.mean, input_tensor_info.normalize.norm, is_rgb_, output_name_list) != ModelBundle::kRetOk) {
+        return kRetErr;
+    }
     input_tensor_info_list_.push_back(input_tensor_info);
 
     /* Set output tensor info */
     output_tensor_info_list_.clear();
-    output_tensor_info_list_.push_back(OutputTensorInfo(OUTPUT_NAME, TENSORTYPE));
+    for (const auto& output_name : output_name_list) {
+        output_tensor_info_list_.push_back(OutputTensorInfo(output_name, TENSORTYPE));
+    }
 
     /* Create and Initialize Inference Helper */
     inference_helper_.reset(InferenceHelper::Create(InferenceHelper::kNcnn));
@@ -77,13 +94,31 @@ int32_t ClassificationEngine::Initialize(const std::string& work_dir, const int3
     }
 
     /* read label */
-    if (ReadLabel(label_filename, label_list_) != kRetOk) {
+    if (bundle.IsOpened()) {
+        bundle.GetLabelList(label_list_);
+    } else if (ReadLabel(label_filename, label_list_) != kRetOk) {
+        return kRetErr;
+    }
+
+    if (Warmup(num_warmup) != kRetOk) {
+        PRINT_E("Warm-up failed\n");
         return kRetErr;
     }
 
     return kRetOk;
 }
 
+int32_t ClassificationEngine::Warmup(int32_t num_warmup)
+{
+    InputTensorInfo& input_tensor_info = input_tensor_info_list_[0];
+    cv::Mat img_src = cv::Mat::zeros(input_tensor_info.GetHeight(), input_tensor_info.GetWidth(), CV_8UC3);
+    Result result;
+    if (!CommonHelper::Warmup(num_warmup, [&]() { return Process(img_src, result) == kRetOk; })) {
+        return kRetErr;
+    }
+    return kRetOk;
+}
+
 int32_t ClassificationEngine::Finalize()
 {
     if (!inference_helper_) {
@@ -113,7 +148,7 @@ int32_t ClassificationEngine::Process(const cv::Mat& original_mat, Result& resul
     cv::Mat img_src = cv::Mat::zeros(input_tensor_info.GetHeight(), input_tensor_info.GetWidth(), CV_8UC3);
     //CommonHelper::CropResizeCvt(original_mat, img_src, crop_x, crop_y, crop_w, crop_h, IS_RGB, CommonHelper::kCropTypeStretch);
     //CommonHelper::CropResizeCvt(original_mat, img_src, crop_x, crop_y, crop_w, crop_h, IS_RGB, CommonHelper::kCropTypeCut);
-    CommonHelper::CropResizeCvt(original_mat, img_src, crop_x, crop_y, crop_w, crop_h, IS_RGB, CommonHelper::kCropTypeExpand);
+    CommonHelper::CropResizeCvt(original_mat, img_src, crop_x, crop_y, crop_w, crop_h, is_rgb_, CommonHelper::kCropTypeExpand);
 
     input_tensor_info.data = img_src.data;
     input_tensor_info.data_type = InputTensorInfo::kDataTypeImage;
@@ -141,24 +176,13 @@ int32_t ClassificationEngine::Process(const cv::Mat& original_mat, Result& resul
 
     /*** PostProcess ***/
     const auto& t_post_process0 = std::chrono::steady_clock::now();
-    /* Retrieve the result */
-    std::vector<float> output_score_list;
-    output_score_list.resize(output_tensor_info_list_[0].GetElementNum());
-    const float* val_float = output_tensor_info_list_[0].GetDataAsFloat();
-    for (int32_t i = 0; i < (int32_t)output_score_list.size(); i++) {
-        output_score_list[i] = val_float[i];
-    }
-
-    /* Find the max score */
-    int32_t max_index = (int32_t)(std::max_element(output_score_list.begin(), output_score_list.end()) - output_score_list.begin());
-    auto max_score = *std::max_element(output_score_list.begin(), output_score_list.end());
-    PRINT("Result = %s (%d) (%.3f)\n", label_list_[max_index].c_str(), max_index, max_score);
+    /* Find the top-K scores */
+    result.top_num = GetTopK(output_tensor_info_list_[0].GetDataAsFloat(), output_tensor_info_list_[0].GetElementNum(), top_k_, use_softmax_, result.top_list.data());
     const auto& t_post_process1 = std::chrono::steady_clock::now();
 
     /* Return the results */
-    result.class_id = max_index;
-    result.class_name = label_list_[max_index];
-    result.score = max_score;
+    result.class_id = result.top_list[0].class_id;
+    result.score = result.top_list[0].score;
     result.time_pre_process = static_cast<std::chrono::duration<double>>(t_pre_process1 - t_pre_process0).count() * 1000.0;
     result.time_inference = static_cast<std::chrono::duration<double>>(t_inference1 - t_inference0).count() * 1000.0;
     result.time_post_process = static_cast<std::chrono::duration<double>>(t_post_process1 - t_post_process0).count() * 1000.0;;
@@ -184,3 +208,41 @@ int32_t ClassificationEngine::ReadLabel(const std::string& filename, std::vector
     }
     return kRetOk;
 }
+
+/* Find top-K scores in one pass using a min-heap of size K. Softmax denominator is calculated in the same pass (online softmax) */
+int32_t ClassificationEngine::GetTopK(const float* score_list, int32_t num, int32_t top_k, bool use_softmax, Score* top_list)
+{
+    const auto comp = [](const Score& lhs, const Score& rhs) { return lhs.score > rhs.score; };    /* the lowest score at front */
+    top_k = (std::min)(top_k, num);
+    int32_t top_num = 0;
+
+    float max_score = score_list[0];
+    float sum_exp = 0;
+    for (int32_t i = 0; i < num; i++) {
+        const float score = score_list[i];
+        if (use_softmax) {
+            if (score > max_score) {
+                sum_exp *= std::exp(max_score - score);
+                max_score = score;
+            }
+            sum_exp += std::exp(score - max_score);
+        }
+
+        if (top_num < top_k) {
+            top_list[top_num++] = { i, score };
+            std::push_heap(top_list, top_list + top_num, comp);
+        } else if (score > top_list[0].score) {
+            std::pop_heap(top_list, top_list + top_num, comp);
+            top_list[top_num - 1] = { i, score };
+            std::push_heap(top_list, top_list + top_num, comp);
+        }
+    }
+    std::sort_heap(top_list, top_list + top_num, comp);   /* descending order */
+
+    if (use_softmax) {
+        for (int32_t i = 0; i < top_num; i++) {
+            top_list[i].score = std::exp(top_list[i].score - max_score) / sum_exp;
+        }
+    }
+    return top_num;
+}
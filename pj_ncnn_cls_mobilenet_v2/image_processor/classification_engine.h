@@ -8,6 +8,7 @@
 #include <vector>
 #include <array>
 #include <memory>
+#include <algorithm>
 
 /* for OpenCV */
 #include <opencv2/opencv.hpp>
@@ -23,14 +24,22 @@ public:
         kRetErr = -1,
     };
 
-    typedef struct Result_ {
+    typedef struct {
         int32_t     class_id;
-        std::string class_name;
         float       score;
+    } Score;
+
+    static constexpr int32_t kTopKMax = 5;
+
+    typedef struct Result_ {
+        int32_t     class_id;               /* use GetLabel(class_id) to get the label */
+        float       score;
+        std::array<Score, kTopKMax> top_list;   /* top-K results in descending order of score (fixed size so that Result doesn't allocate memory) */
+        int32_t     top_num;
         double      time_pre_process;		// [msec]
         double      time_inference;			// [msec]
         double      time_post_process;		// [msec]
-        Result_() : class_id(0), class_name(""), score(0.0f), time_pre_process(0), time_inference(0), time_post_process(0)
+        Result_() : class_id(0), score(0.0f), top_num(0), time_pre_process(0), time_inference(0), time_post_process(0)
         {}
     } Result;
 
@@ -38,13 +47,27 @@ private:
     static constexpr bool with_background = false;
     
 public:
-    ClassificationEngine() {}
+    ClassificationEngine() {
+        top_k_ = 1;
+        use_softmax_ = false;
+        is_rgb_ = true;
+    }
     ~ClassificationEngine() {}
-    int32_t Initialize(const std::string& work_dir, const int32_t num_threads);
+    int32_t Initialize(const std::string& work_dir, const int32_t num_threads, const int32_t num_warmup = 0);
     int32_t Finalize(void);
     int32_t Process(const cv::Mat& original_mat, Result& result);
+    /* score is converted to probability by softmax if use_softmax is true. top_k is clipped to [1, kTopKMax] */
+    void SetTopK(int32_t top_k, bool use_softmax) {
+        top_k_ = (std::min)((std::max)(1, top_k), kTopKMax);
+        use_softmax_ = use_softmax;
+    }
+    const std::string& GetLabel(int32_t class_id) const { return label_list_[class_id]; }
+
+    /* top_list must have space for top_k elements. Return the number of elements stored in top_list */
+    static int32_t GetTopK(const float* score_list, int32_t num, int32_t top_k, bool use_softmax, Score* top_list);
 
 private:
+    int32_t Warmup(int32_t num_warmup);
     int32_t ReadLabel(const std::string& filename, std::vector<std::string>& label_list);
 
 private:
@@ -52,6 +75,10 @@ private:
     std::vector<InputTensorInfo> input_tensor_info_list_;
     std::vector<OutputTensorInfo> output_tensor_info_list_;
     std::vector<std::string> label_list_;
+    bool is_rgb_;
+
+    int32_t top_k_;
+    bool use_softmax_;
 };
 
 #endif
@@ -18,6 +18,7 @@
 /* for My modules */
 #include "common_helper.h"
 #include "common_helper_cv.h"
+#include "thread_placement.h"
 #include "classification_engine.h"
 #include "image_processor.h"
 
@@ -28,6 +29,7 @@
 
 /*** Global variable ***/
 std::unique_ptr<ClassificationEngine> s_classification_engine;
+ThreadPlacement s_thread_placement;
 
 /*** Function ***/
 static void DrawFps(cv::Mat& mat, double time_inference, cv::Point pos, double font_scale, int32_t thickness, cv::Scalar color_front, cv::Scalar color_back, bool is_text_on_rect = true)
@@ -48,10 +50,16 @@ int32_t ImageProcessor::Initialize(const InputParam& input_param)
         return -1;
     }
 
+    if (s_thread_placement.Initialize(input_param.cpu_affinity, input_param.num_threads) != ThreadPlacement::kRetOk) {
+        return -1;
+    }
+    s_thread_placement.Apply();
+
     s_classification_engine.reset(new ClassificationEngine());
-    if (s_classification_engine->Initialize(input_param.work_dir, input_param.num_threads) != ClassificationEngine::kRetOk) {
+    if (s_classification_engine->Initialize(input_param.work_dir, s_thread_placement.GetThreadNum(), input_param.num_warmup) != ClassificationEngine::kRetOk) {
         return -1;
     }
+    s_classification_engine->SetTopK(NUM_MAX_TOP, false);
     return 0;
 }
 
@@ -92,6 +100,7 @@ int32_t ImageProcessor::Process(cv::Mat& mat, Result& result)
         PRINT_E("Not initialized\n");
         return -1;
     }
+    s_thread_placement.Apply();
 
     ClassificationEngine::Result cls_result;
     if (s_classification_engine->Process(mat, cls_result) != ClassificationEngine::kRetOk) {
@@ -99,16 +108,22 @@ int32_t ImageProcessor::Process(cv::Mat& mat, Result& result)
     }
 
     /* Draw the result */
+    const std::string& label = s_classification_engine->GetLabel(cls_result.class_id);
     char text[64];
-    snprintf(text, sizeof(text), "Result: %s (score = %.3f)",  cls_result.class_name.c_str(), cls_result.score);
+    snprintf(text, sizeof(text), "Result: %s (score = %.3f)",  label.c_str(), cls_result.score);
     CommonHelper::DrawText(mat, text, cv::Point(0, 20), 0.5, 2, CommonHelper::CreateCvColor(0, 0, 0), CommonHelper::CreateCvColor(180, 180, 180), true);
 
     DrawFps(mat, cls_result.time_inference, cv::Point(0, 0), 0.5, 2, CommonHelper::CreateCvColor(0, 0, 0), CommonHelper::CreateCvColor(180, 180, 180), true);
 
     /* Return the results */
     result.class_id = cls_result.class_id;
-    snprintf(result.label, sizeof(result.label), "%s", cls_result.class_name.c_str());
+    snprintf(result.label, sizeof(result.label), "%s", label.c_str());
     result.score = cls_result.score;
+    result.top_num = (std::min)(cls_result.top_num, NUM_MAX_TOP);
+    for (int32_t i = 0; i < result.top_num; i++) {
+        result.top_list[i].class_id = cls_result.top_list[i].class_id;
+        result.top_list[i].score = cls_result.top_list[i].score;
+    }
     result.time_pre_process = cls_result.time_pre_process;
     result.time_inference = cls_result.time_inference;
     result.time_post_process = cls_result.time_post_process;
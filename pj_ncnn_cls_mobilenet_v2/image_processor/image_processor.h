@@ -17,13 +17,22 @@ namespace ImageProcessor
 
 typedef struct {
     char     work_dir[256];
-    int32_t  num_threads;
+    int32_t  num_threads;       /* 0: the number of cores in cpu_affinity (all cores when not pinned) */
+    int32_t  num_warmup;        /* number of dummy inferences in Initialize (0: no warm-up) */
+    char     cpu_affinity[32];  /* Pin inference threads to cores. "": not pinned, "all", "big", "little", or core list (e.g. "4-7") */
 } InputParam;
 
+#define NUM_MAX_TOP 5
+
 typedef struct {
     int32_t  class_id;
     char     label[256];
     double   score;
+    int32_t  top_num;
+    struct {
+        int32_t  class_id;
+        double   score;
+    } top_list[NUM_MAX_TOP];
     double   time_pre_process;   // [msec]
     double   time_inference;     // [msec]
     double   time_post_process;  // [msec]
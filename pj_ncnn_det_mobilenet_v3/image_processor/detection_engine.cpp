@@ -18,6 +18,7 @@
 #include "common_helper.h"
 #include "common_helper_cv.h"
 #include "inference_helper.h"
+#include "model_bundle.h"
 #include "detection_engine.h"
 
 /*** Macro ***/
@@ -34,14 +35,23 @@
 #define IS_RGB        true
 #define OUTPUT_NAME  "detection_out"
 #define LABEL_NAME   "label_PASCAL_VOC2012.txt"
+#define BUNDLE_NAME  "mobilenetv3_ssdlite_voc.bundle"     /* model information in the bundle is used instead of the values above if exists */
 
 
 /*** Function ***/
-int32_t DetectionEngine::Initialize(const std::string& work_dir, const int32_t num_threads)
+int32_t DetectionEngine::Initialize(const std::string& work_dir, const int32_t num_threads, const int32_t num_warmup)
 {
     /* Set model information */
     std::string model_filename = work_dir + "/model/" + MODEL_NAME;
     std::string label_filename = work_dir + "/model/" + LABEL_NAME;
+    ModelBundle bundle;
+    const std::string bundle_filename = work_dir + "/model/" + BUNDLE_NAME;
+    if (std::ifstream(bundle_filename).good()) {
+        if (bundle.Open(bundle_filename) != ModelBundle::kRetOk) {
+            return kRetErr;
+        }
+        model_filename = work_dir + "/model/" + bundle.GetMeta("model_file", MODEL_NAME);
+    }
 
     /* Set input tensor info */
     input_tensor_info_list_.clear();
@@ -54,11 +64,18 @@ int32_t DetectionEngine::Initialize(const std::string& work_dir, const int32_t n
     input_tensor_info.normalize.norm[0] = 1 / 255.0f;
     input_tensor_info.normalize.norm[1] = 1 / 255.0f;
     input_tensor_info.normalize.norm[2] = 1 / 255.0f;
+    is_rgb_ = IS_RGB;
+    std::vector<std::string> output_name_list = { OUTPUT_NAME };
+    if (bundle.IsOpened() && bundle.GetModelInfo(input_tensor_info.name, input_tensor_info.tensor_dims, input_tensor_info.normalize.mean, input_tensor_info.normalize.norm, is_rgb_, output_name_list) != ModelBundle::kRetOk) {
+        return kRetErr;
+    }
     input_tensor_info_list_.push_back(input_tensor_info);
 
     /* Set output tensor info */
     output_tensor_info_list_.clear();
-    output_tensor_info_list_.push_back(OutputTensorInfo(OUTPUT_NAME, TENSORTYPE));
+    for (const auto& output_name : output_name_list) {
+        output_tensor_info_list_.push_back(OutputTensorInfo(output_name, TENSORTYPE));
+    }
 
     /* Create and Initialize Inference Helper */
     //inference_helper_.reset(InferenceHelper::Create(InferenceHelper::OPEN_CV));
@@ -78,13 +95,31 @@ int32_t DetectionEngine::Initialize(const std::string& work_dir, const int32_t n
     }
 
     /* read label */
-    if (ReadLabel(label_filename, label_list_) != kRetOk) {
+    if (bundle.IsOpened()) {
+        bundle.GetLabelList(label_list_);
+    } else if (ReadLabel(label_filename, label_list_) != kRetOk) {
+        return kRetErr;
+    }
+
+    if (Warmup(num_warmup) != kRetOk) {
+        PRINT_E("Warm-up failed\n");
         return kRetErr;
     }
 
     return kRetOk;
 }
 
+int32_t DetectionEngine::Warmup(int32_t num_warmup)
+{
+    InputTensorInfo& input_tensor_info = input_tensor_info_list_[0];
+    cv::Mat img_src = cv::Mat::zeros(input_tensor_info.GetHeight(), input_tensor_info.GetWidth(), CV_8UC3);
+    Result result;
+    if (!CommonHelper::Warmup(num_warmup, [&]() { return Process(img_src, result) == kRetOk; })) {
+        return kRetErr;
+    }
+    return kRetOk;
+}
+
 int32_t DetectionEngine::Finalize()
 {
     if (!inference_helper_) {
@@ -112,7 +147,7 @@ int32_t DetectionEngine::Process(const cv::Mat& original_mat, Result& result)
     int32_t crop_h = original_mat.rows;
     cv::Mat img_src = cv::Mat::zeros(input_tensor_info.GetHeight(), input_tensor_info.GetWidth(), CV_8UC3);
     //CommonHelper::CropResizeCvt(original_mat, img_src, crop_x, crop_y, crop_w, crop_h, IS_RGB, CommonHelper::kCropTypeStretch);
-    CommonHelper::CropResizeCvt(original_mat, img_src, crop_x, crop_y, crop_w, crop_h, IS_RGB, CommonHelper::kCropTypeCut);
+    CommonHelper::CropResizeCvt(original_mat, img_src, crop_x, crop_y, crop_w, crop_h, is_rgb_, CommonHelper::kCropTypeCut);
     //CommonHelper::CropResizeCvt(original_mat, img_src, crop_x, crop_y, crop_w, crop_h, IS_RGB, CommonHelper::kCropTypeExpand);
 
     input_tensor_info.data = img_src.data;
@@ -43,13 +43,14 @@ public:
     } Result;
 
 public:
-    DetectionEngine() {}
+    DetectionEngine() : is_rgb_(true) {}
     ~DetectionEngine() {}
-    int32_t Initialize(const std::string& work_dir, const int32_t num_threads);
+    int32_t Initialize(const std::string& work_dir, const int32_t num_threads, const int32_t num_warmup = 0);
     int32_t Finalize(void);
     int32_t Process(const cv::Mat& original_mat, Result& result);
 
 private:
+    int32_t Warmup(int32_t num_warmup);
     int32_t ReadLabel(const std::string& filename, std::vector<std::string>& label_list);
     int32_t GetObject(const OutputTensorInfo& rawOutput, std::vector<Object>& object_list, double threshold, int32_t width = -1, int32_t height = -1);
 
@@ -58,6 +59,7 @@ private:
     std::vector<InputTensorInfo> input_tensor_info_list_;
     std::vector<OutputTensorInfo> output_tensor_info_list_;
     std::vector<std::string> label_list_;
+    bool is_rgb_;
 };
 
 #endif
@@ -18,6 +18,7 @@
 /* for My modules */
 #include "common_helper.h"
 #include "common_helper_cv.h"
+#include "thread_placement.h"
 #include "detection_engine.h"
 #include "image_processor.h"
 
@@ -28,6 +29,7 @@
 
 /*** Global variable ***/
 std::unique_ptr<DetectionEngine> s_engine;
+ThreadPlacement s_thread_placement;
 
 /*** Function ***/
 static void DrawFps(cv::Mat& mat, double time_inference, cv::Point pos, double font_scale, int32_t thickness, cv::Scalar color_front, cv::Scalar color_back, bool is_text_on_rect = true)
@@ -48,8 +50,13 @@ int32_t ImageProcessor::Initialize(const InputParam& input_param)
         return -1;
     }
 
+    if (s_thread_placement.Initialize(input_param.cpu_affinity, input_param.num_threads) != ThreadPlacement::kRetOk) {
+        return -1;
+    }
+    s_thread_placement.Apply();
+
     s_engine.reset(new DetectionEngine());
-    if (s_engine->Initialize(input_param.work_dir, input_param.num_threads) != DetectionEngine::kRetOk) {
+    if (s_engine->Initialize(input_param.work_dir, s_thread_placement.GetThreadNum(), input_param.num_warmup) != DetectionEngine::kRetOk) {
         s_engine->Finalize();
         s_engine.reset();
         return -1;
@@ -94,6 +101,7 @@ int32_t ImageProcessor::Process(cv::Mat& mat, Result& result)
         PRINT_E("Not initialized\n");
         return -1;
     }
+    s_thread_placement.Apply();
 
     DetectionEngine::Result det_result;
     det_result.object_list.clear();
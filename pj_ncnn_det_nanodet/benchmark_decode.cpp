@@ -0,0 +1,168 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+/* Benchmark for NanoDet post process (DetectionEngine::DecodeInfer) using synthetic score maps. Model files are not needed */
+/*** Include ***/
+/* for general */
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+/* for My modules */
+#include "detection_engine.h"
+
+/*** Macro ***/
+#define MODEL_WIDTH     320
+#define MODEL_HEIGHT    320
+#define NUM_CLASS       80
+#define REG_MAX         7
+#define THRESHOLD       0.4f
+#define LOOP_NUM        200
+
+static constexpr int32_t kStrideList[] = { 8, 16, 32 };
+
+/*** Function ***/
+static inline float fast_exp(float x)
+{
+    union {
+        uint32_t i;
+        float f;
+    } v{};
+    v.i = static_cast<int32_t>((1 << 23) * (1.4426950409 * x + 126.93490512f));
+    return v.f;
+}
+
+/* Decoder before optimization (full class scan with std::vector allocation for each survivor). Used as the reference */
+static void DecodeInferReference(std::vector<DetectionEngine::Object>& object_list, const float* cls_pred, int32_t cls_pred_step, const float* dis_pred, int32_t dis_pred_step, float threshold, int32_t stride)
+{
+    int32_t feature_w = MODEL_WIDTH / stride;
+    int32_t feature_h = MODEL_HEIGHT / stride;
+    for (int32_t idx = 0; idx < feature_h * feature_w; idx++) {
+        float score_max = 0;
+        int32_t class_id_max = 0;
+        for (int32_t label = 0; label < NUM_CLASS; label++) {
+            float current_score = cls_pred[cls_pred_step * idx + label];
+            if (current_score > score_max) {
+                score_max = current_score;
+                class_id_max = label;
+            }
+        }
+        if (score_max > threshold) {
+            float ct_x = (idx % feature_w + 0.5f) * stride;
+            float ct_y = (idx / feature_w + 0.5f) * stride;
+            std::vector<float> dis(4);
+            for (int32_t i = 0; i < 4; i++) {
+                const float* src = dis_pred + dis_pred_step * idx + i * (REG_MAX + 1);
+                float alpha = *std::max_element(src, src + REG_MAX + 1);
+                std::vector<float> sm(REG_MAX + 1);
+                float denominator = 0;
+                for (int32_t j = 0; j < REG_MAX + 1; j++) {
+                    sm[j] = fast_exp(src[j] - alpha);
+                    denominator += sm[j];
+                }
+                for (int32_t j = 0; j < REG_MAX + 1; j++) {
+                    sm[j] /= denominator;
+                }
+                for (int32_t j = 0; j < REG_MAX + 1; j++) {
+                    dis[i] += j * sm[j];
+                }
+                dis[i] *= stride;
+            }
+            DetectionEngine::Object object;
+            object.class_id = class_id_max;
+            object.score = score_max;
+            object.x = (std::max)(ct_x - dis[0], 0.0f);
+            object.y = (std::max)(ct_y - dis[1], 0.0f);
+            object.width = (std::min)(ct_x + dis[2] - object.x, MODEL_WIDTH - object.x);
+            object.height = (std::min)(ct_y + dis[3] - object.y, MODEL_HEIGHT - object.y);
+            object_list.push_back(object);
+        }
+    }
+}
+
+/* Create score map where (density * 100)% of cells have a class over the threshold */
+static void CreateSyntheticOutput(std::mt19937& engine, float density, int32_t num_cell, std::vector<float>& cls_pred, std::vector<float>& dis_pred)
+{
+    std::uniform_real_distribution<float> dist_low(0.0f, THRESHOLD * 0.9f);
+    std::uniform_real_distribution<float> dist_high(THRESHOLD + 0.05f, 1.0f);
+    std::uniform_real_distribution<float> dist_uniform(0.0f, 1.0f);
+    std::uniform_real_distribution<float> dist_reg(-4.0f, 4.0f);
+    std::uniform_int_distribution<int32_t> dist_class(0, NUM_CLASS - 1);
+
+    cls_pred.resize(num_cell * NUM_CLASS);
+    dis_pred.resize(num_cell * 4 * (REG_MAX + 1));
+    for (int32_t idx = 0; idx < num_cell; idx++) {
+        for (int32_t c = 0; c < NUM_CLASS; c++) cls_pred[idx * NUM_CLASS + c] = dist_low(engine);
+        if (dist_uniform(engine) < density) cls_pred[idx * NUM_CLASS + dist_class(engine)] = dist_high(engine);
+    }
+    for (auto& v : dis_pred) v = dist_reg(engine);
+}
+
+int32_t main(int argc, char* argv[])
+{
+    std::mt19937 engine(1234);
+    printf("Input: %d x %d, %d classes, threshold = %.2f, %d loops\n", MODEL_WIDTH, MODEL_HEIGHT, NUM_CLASS, THRESHOLD, LOOP_NUM);
+    printf("%8s %8s %14s %14s %8s\n", "density", "objects", "reference[ms]", "decoder[ms]", "speedup");
+
+    for (float density : { 0.0f, 0.01f, 0.1f, 0.5f, 1.0f }) {
+        std::vector<std::vector<float>> cls_pred_list(3);
+        std::vector<std::vector<float>> dis_pred_list(3);
+        for (int32_t i = 0; i < 3; i++) {
+            int32_t num_cell = (MODEL_WIDTH / kStrideList[i]) * (MODEL_HEIGHT / kStrideList[i]);
+            CreateSyntheticOutput(engine, density, num_cell, cls_pred_list[i], dis_pred_list[i]);
+        }
+
+        std::vector<DetectionEngine::Object> object_list_reference;
+        std::vector<DetectionEngine::Object> object_list;
+        double time_reference = 0;
+        double time_decoder = 0;
+        for (int32_t loop = 0; loop < LOOP_NUM; loop++) {
+            object_list_reference.clear();
+            const auto& t0 = std::chrono::steady_clock::now();
+            for (int32_t i = 0; i < 3; i++) {
+                DecodeInferReference(object_list_reference, cls_pred_list[i].data(), NUM_CLASS, dis_pred_list[i].data(), 4 * (REG_MAX + 1), THRESHOLD, kStrideList[i]);
+            }
+            const auto& t1 = std::chrono::steady_clock::now();
+
+            object_list.clear();
+            const auto& t2 = std::chrono::steady_clock::now();
+            for (int32_t i = 0; i < 3; i++) {
+                DetectionEngine::DecodeInfer(object_list, cls_pred_list[i].data(), NUM_CLASS, dis_pred_list[i].data(), 4 * (REG_MAX + 1), THRESHOLD, kStrideList[i], MODEL_WIDTH, MODEL_HEIGHT);
+            }
+            const auto& t3 = std::chrono::steady_clock::now();
+            time_reference += static_cast<std::chrono::duration<double>>(t1 - t0).count() * 1000.0;
+            time_decoder += static_cast<std::chrono::duration<double>>(t3 - t2).count() * 1000.0;
+        }
+
+        /* Check the result (allow small error because the order of floating point operations is different) */
+        bool is_same = object_list.size() == object_list_reference.size();
+        for (size_t i = 0; is_same && i < object_list.size(); i++) {
+            const auto& a = object_list[i];
+            const auto& b = object_list_reference[i];
+            is_same = a.class_id == b.class_id && a.score == b.score
+                && std::abs(a.x - b.x) < 1.0f && std::abs(a.y - b.y) < 1.0f && std::abs(a.width - b.width) < 1.0f && std::abs(a.height - b.height) < 1.0f;
+        }
+
+        printf("%8.2f %8d %14.4f %14.4f %7.2fx %s\n", density, static_cast<int32_t>(object_list.size()), time_reference / LOOP_NUM, time_decoder / LOOP_NUM,
+            time_reference / time_decoder, is_same ? "" : "(MISMATCH)");
+    }
+
+    return 0;
+}
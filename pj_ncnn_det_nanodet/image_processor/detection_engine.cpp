@@ -17,6 +17,7 @@
 /* for My modules */
 #include "common_helper.h"
 #include "common_helper_cv.h"
+#include "model_bundle.h"
 #include "inference_helper.h"
 #include "detection_engine.h"
 
@@ -42,17 +43,27 @@
 #define OUTPUT_5_NAME  "839"
 
 #define LABEL_NAME   "coco_label.txt"
+#define BUNDLE_NAME  "nanodet_m.bundle"     /* model information in the bundle is used instead of the values above if exists */
 
 
 #define NUM_CLASS 80
 #define REG_MAX 7
+static constexpr int32_t kStrideList[] = { 8, 16, 32 };
 
 /*** Function ***/
-int32_t DetectionEngine::Initialize(const std::string& work_dir, const int32_t num_threads)
+int32_t DetectionEngine::Initialize(const std::string& work_dir, const int32_t num_threads, const int32_t num_warmup)
 {
     /* Set model information */
     std::string model_filename = work_dir + "/model/" + MODEL_NAME;
     std::string label_filename = work_dir + "/model/" + LABEL_NAME;
+    ModelBundle bundle;
+    const std::string bundle_filename = work_dir + "/model/" + BUNDLE_NAME;
+    if (std::ifstream(bundle_filename).good()) {
+        if (bundle.Open(bundle_filename) != ModelBundle::kRetOk) {
+            return kRetErr;
+        }
+        model_filename = work_dir + "/model/" + bundle.GetMeta("model_file", MODEL_NAME);
+    }
 
     /* Set input tensor info */
     input_tensor_info_list_.clear();
@@ -65,16 +76,22 @@ int32_t DetectionEngine::Initialize(const std::string& work_dir, const int32_t n
     input_tensor_info.normalize.norm[0] = 0.289f;
     input_tensor_info.normalize.norm[1] = 0.274f;
     input_tensor_info.normalize.norm[2] = 0.278f;
+    is_rgb_ = IS_RGB;
+    std::vector<std::string> output_name_list = { OUTPUT_0_NAME, OUTPUT_1_NAME, OUTPUT_2_NAME, OUTPUT_3_NAME, OUTPUT_4_NAME, OUTPUT_5_NAME };
+    if (bundle.IsOpened() && bundle.GetModelInfo(input_tensor_info.name, input_tensor_info.tensor_dims, input_tensor_info.normalize.mean, input_tensor_info.normalize.norm, is_rgb_, output_name_list) != ModelBundle::kRetOk) {
+        return kRetErr;
+    }
+    if (input_width_ > 0 && input_height_ > 0) {
+        input_tensor_info.tensor_dims[2] = input_height_;
+        input_tensor_info.tensor_dims[3] = input_width_;
+    }
     input_tensor_info_list_.push_back(input_tensor_info);
 
     /* Set output tensor info */
     output_tensor_info_list_.clear();
-    output_tensor_info_list_.push_back(OutputTensorInfo(OUTPUT_0_NAME, TENSORTYPE));
-    output_tensor_info_list_.push_back(OutputTensorInfo(OUTPUT_1_NAME, TENSORTYPE));
-    output_tensor_info_list_.push_back(OutputTensorInfo(OUTPUT_2_NAME, TENSORTYPE));
-    output_tensor_info_list_.push_back(OutputTensorInfo(OUTPUT_3_NAME, TENSORTYPE));
-    output_tensor_info_list_.push_back(OutputTensorInfo(OUTPUT_4_NAME, TENSORTYPE));
-    output_tensor_info_list_.push_back(OutputTensorInfo(OUTPUT_5_NAME, TENSORTYPE));
+    for (const auto& output_name : output_name_list) {
+        output_tensor_info_list_.push_back(OutputTensorInfo(output_name, TENSORTYPE));
+    }
 
     /* Create and Initialize Inference Helper */
     inference_helper_.reset(InferenceHelper::Create(InferenceHelper::kNcnn));
@@ -92,11 +109,47 @@ int32_t DetectionEngine::Initialize(const std::string& work_dir, const int32_t n
     }
 
     /* read label */
-    if (ReadLabel(label_filename, label_list_) != kRetOk) {
+    if (bundle.IsOpened()) {
+        bundle.GetLabelList(label_list_);
+    } else if (ReadLabel(label_filename, label_list_) != kRetOk) {
+        return kRetErr;
+    }
+
+
+    if (Warmup(num_warmup) != kRetOk) {
+        PRINT_E("Warm-up failed\n");
         return kRetErr;
     }
 
+    return kRetOk;
+}
+
+int32_t DetectionEngine::Warmup(int32_t num_warmup)
+{
+    InputTensorInfo& input_tensor_info = input_tensor_info_list_[0];
+    cv::Mat img_src = cv::Mat::zeros(input_tensor_info.GetHeight(), input_tensor_info.GetWidth(), CV_8UC3);
+    Result result;
+    if (!CommonHelper::Warmup(num_warmup, [&]() { return Process(img_src, result) == kRetOk; })) {
+        return kRetErr;
+    }
+    return kRetOk;
+}
 
+int32_t DetectionEngine::SetInputSize(int32_t width, int32_t height)
+{
+    /* The model is fully convolutional. Feature map size for each stride is derived from the input size in DecodeInfer */
+    for (const auto& stride : kStrideList) {
+        if (width <= 0 || height <= 0 || width % stride != 0 || height % stride != 0) {
+            PRINT_E("Invalid input size (%d x %d). It must be multiples of %d\n", width, height, stride);
+            return kRetErr;
+        }
+    }
+    input_width_ = width;
+    input_height_ = height;
+    if (!input_tensor_info_list_.empty()) {
+        input_tensor_info_list_[0].tensor_dims[2] = height;
+        input_tensor_info_list_[0].tensor_dims[3] = width;
+    }
     return kRetOk;
 }
 
@@ -128,20 +181,9 @@ int32_t DetectionEngine::Process(const cv::Mat& original_mat, Result& result)
     cv::Mat img_src = cv::Mat::zeros(input_tensor_info.GetHeight(), input_tensor_info.GetWidth(), CV_8UC3);
     //CommonHelper::CropResizeCvt(original_mat, img_src, crop_x, crop_y, crop_w, crop_h, IS_RGB, CommonHelper::kCropTypeStretch);
     //CommonHelper::CropResizeCvt(original_mat, img_src, crop_x, crop_y, crop_w, crop_h, IS_RGB, CommonHelper::kCropTypeCut);
-    CommonHelper::CropResizeCvt(original_mat, img_src, crop_x, crop_y, crop_w, crop_h, IS_RGB, CommonHelper::kCropTypeExpand);
+    CommonHelper::CropResizeCvt(original_mat, img_src, crop_x, crop_y, crop_w, crop_h, is_rgb_, CommonHelper::kCropTypeExpand);
 
-    input_tensor_info.data = img_src.data;
-    input_tensor_info.data_type = InputTensorInfo::kDataTypeImage;
-    input_tensor_info.image_info.width = img_src.cols;
-    input_tensor_info.image_info.height = img_src.rows;
-    input_tensor_info.image_info.channel = img_src.channels();
-    input_tensor_info.image_info.crop_x = 0;
-    input_tensor_info.image_info.crop_y = 0;
-    input_tensor_info.image_info.crop_width = img_src.cols;
-    input_tensor_info.image_info.crop_height = img_src.rows;
-    input_tensor_info.image_info.is_bgr = false;
-    input_tensor_info.image_info.swap_color = false;
-    if (inference_helper_->PreProcess(input_tensor_info_list_) != InferenceHelper::kRetOk) {
+    if (PreProcessImage(img_src) != kRetOk) {
         return kRetErr;
     }
     const auto& t_pre_process1 = std::chrono::steady_clock::now();
@@ -156,17 +198,14 @@ int32_t DetectionEngine::Process(const cv::Mat& original_mat, Result& result)
     /*** PostProcess ***/
     const auto& t_post_process0 = std::chrono::steady_clock::now();
     /* Retrieve result */
-    std::vector<Object> object_list;
-    DecodeInfer(object_list, output_tensor_info_list_[0], output_tensor_info_list_[1], 0.4, 8, input_tensor_info.GetWidth(), input_tensor_info.GetHeight());
-    DecodeInfer(object_list, output_tensor_info_list_[2], output_tensor_info_list_[3], 0.4, 16, input_tensor_info.GetWidth(), input_tensor_info.GetHeight());
-    DecodeInfer(object_list, output_tensor_info_list_[4], output_tensor_info_list_[5], 0.4, 32, input_tensor_info.GetWidth(), input_tensor_info.GetHeight());
+    DecodeOutput(object_list_);
 
     /* NMS */
-    std::vector<Object> object_list_nms;
-    Nms(object_list, object_list_nms, false);
+    object_list_nms_.clear();
+    Nms(object_list_, object_list_nms_, false);
 
     /* Convert coordinate (model size to image size) */
-    for (auto& object : object_list_nms) {
+    for (auto& object : object_list_nms_) {
         object.x = (object.x * crop_w) / input_tensor_info.GetWidth() + crop_x;
         object.width = (object.width * crop_w) / input_tensor_info.GetWidth();
         object.y = (object.y * crop_h) / input_tensor_info.GetHeight() + crop_y;
@@ -175,7 +214,7 @@ int32_t DetectionEngine::Process(const cv::Mat& original_mat, Result& result)
     const auto& t_post_process1 = std::chrono::steady_clock::now();
 
     /* Return the results */
-    result.object_list = object_list_nms;
+    result.object_list = object_list_nms_;
     result.time_pre_process = static_cast<std::chrono::duration<double>>(t_pre_process1 - t_pre_process0).count() * 1000.0;
     result.time_inference = static_cast<std::chrono::duration<double>>(t_inference1 - t_inference0).count() * 1000.0;
     result.time_post_process = static_cast<std::chrono::duration<double>>(t_post_process1 - t_post_process0).count() * 1000.0;;
@@ -184,6 +223,109 @@ int32_t DetectionEngine::Process(const cv::Mat& original_mat, Result& result)
 }
 
 
+int32_t DetectionEngine::ProcessMosaic(const cv::Mat& original_mat, const std::vector<cv::Rect>& roi_list, Result& result)
+{
+    if (roi_list.empty() || static_cast<int32_t>(roi_list.size()) > kMosaicTileMax) {
+        return Process(original_mat, result);
+    }
+    if (!inference_helper_) {
+        PRINT_E("Inference helper is not created\n");
+        return kRetErr;
+    }
+    /*** PreProcess ***/
+    const auto& t_pre_process0 = std::chrono::steady_clock::now();
+    InputTensorInfo& input_tensor_info = input_tensor_info_list_[0];
+    /* Each ROI is letterboxed into its own tile, so small objects keep (close to) native resolution */
+    /* The image is reused across frames. It's cleared every frame because tiles don't write the letterbox margins */
+    mosaic_image_.create(input_tensor_info.GetHeight(), input_tensor_info.GetWidth(), CV_8UC3);
+    mosaic_image_.setTo(cv::Scalar(0, 0, 0));
+    CommonHelper::CropResizeCvtMosaic(original_mat, mosaic_image_, roi_list, mosaic_tile_list_, is_rgb_);
+    if (PreProcessImage(mosaic_image_) != kRetOk) {
+        return kRetErr;
+    }
+    const auto& t_pre_process1 = std::chrono::steady_clock::now();
+
+    /*** Inference ***/
+    const auto& t_inference0 = std::chrono::steady_clock::now();
+    if (inference_helper_->Process(output_tensor_info_list_) != InferenceHelper::kRetOk) {
+        return kRetErr;
+    }
+    const auto& t_inference1 = std::chrono::steady_clock::now();
+
+    /*** PostProcess ***/
+    const auto& t_post_process0 = std::chrono::steady_clock::now();
+    /* Retrieve result in the mosaic image coordinate */
+    object_list_nms_.clear();
+    DecodeOutput(object_list_nms_);
+
+    /* Convert coordinate (tile to image) via the tile which contains the center. An object over tiles is clipped to the tile */
+    object_list_.clear();
+    for (const auto& object : object_list_nms_) {
+        int32_t index = CommonHelper::FindMosaicTile(mosaic_tile_list_, static_cast<int32_t>(object.x + object.width / 2), static_cast<int32_t>(object.y + object.height / 2));
+        if (index < 0) continue;
+        const cv::Rect& tile = mosaic_tile_list_[index].tile;
+        const cv::Rect& crop = mosaic_tile_list_[index].crop;
+        float x0 = (std::max)(object.x, static_cast<float>(tile.x)) - tile.x;
+        float y0 = (std::max)(object.y, static_cast<float>(tile.y)) - tile.y;
+        float x1 = (std::min)(object.x + object.width, static_cast<float>(tile.x + tile.width)) - tile.x;
+        float y1 = (std::min)(object.y + object.height, static_cast<float>(tile.y + tile.height)) - tile.y;
+        Object object_image = object;
+        object_image.x = (x0 * crop.width) / tile.width + crop.x;
+        object_image.width = ((x1 - x0) * crop.width) / tile.width;
+        object_image.y = (y0 * crop.height) / tile.height + crop.y;
+        object_image.height = ((y1 - y0) * crop.height) / tile.height;
+        object_list_.push_back(object_image);
+    }
+
+    /* NMS (the same object may be detected in overlapped ROIs) */
+    object_list_nms_.clear();
+    Nms(object_list_, object_list_nms_, false);
+    const auto& t_post_process1 = std::chrono::steady_clock::now();
+
+    /* Return the results */
+    result.object_list = object_list_nms_;
+    result.time_pre_process = static_cast<std::chrono::duration<double>>(t_pre_process1 - t_pre_process0).count() * 1000.0;
+    result.time_inference = static_cast<std::chrono::duration<double>>(t_inference1 - t_inference0).count() * 1000.0;
+    result.time_post_process = static_cast<std::chrono::duration<double>>(t_post_process1 - t_post_process0).count() * 1000.0;
+
+    return kRetOk;
+}
+
+
+int32_t DetectionEngine::PreProcessImage(const cv::Mat& img_src)
+{
+    InputTensorInfo& input_tensor_info = input_tensor_info_list_[0];
+    input_tensor_info.data = img_src.data;
+    input_tensor_info.data_type = InputTensorInfo::kDataTypeImage;
+    input_tensor_info.image_info.width = img_src.cols;
+    input_tensor_info.image_info.height = img_src.rows;
+    input_tensor_info.image_info.channel = img_src.channels();
+    input_tensor_info.image_info.crop_x = 0;
+    input_tensor_info.image_info.crop_y = 0;
+    input_tensor_info.image_info.crop_width = img_src.cols;
+    input_tensor_info.image_info.crop_height = img_src.rows;
+    input_tensor_info.image_info.is_bgr = false;
+    input_tensor_info.image_info.swap_color = false;
+    if (inference_helper_->PreProcess(input_tensor_info_list_) != InferenceHelper::kRetOk) {
+        return kRetErr;
+    }
+    return kRetOk;
+}
+
+
+void DetectionEngine::DecodeOutput(std::vector<Object>& object_list)
+{
+    InputTensorInfo& input_tensor_info = input_tensor_info_list_[0];
+    object_list.clear();
+    for (int32_t i = 0; i < 3; i++) {
+        const OutputTensorInfo& cls_pred = output_tensor_info_list_[i * 2 + 0];
+        const OutputTensorInfo& dis_pred = output_tensor_info_list_[i * 2 + 1];
+        DecodeInfer(object_list, static_cast<const float*>(cls_pred.data), cls_pred.tensor_dims[3], static_cast<const float*>(dis_pred.data), dis_pred.tensor_dims[3],
+            0.4f, kStrideList[i], input_tensor_info.GetWidth(), input_tensor_info.GetHeight());
+    }
+}
+
+
 int32_t DetectionEngine::ReadLabel(const std::string& filename, std::vector<std::string>& label_list)
 {
     std::ifstream ifs(filename);
@@ -199,102 +341,95 @@ int32_t DetectionEngine::ReadLabel(const std::string& filename, std::vector<std:
     return kRetOk;
 }
 
-/* Original code: https://github.com/RangiLyu/nanodet/blob/main/demo_ncnn/nanodet.cpp */
-int32_t DetectionEngine::DecodeInfer(std::vector<Object>& object_list, const OutputTensorInfo& cls_pred, const OutputTensorInfo& dis_pred, double threshold, int32_t stride, int32_t model_width, int32_t model_height)
-{
-    int32_t feature_w = model_width / stride;
-    int32_t feature_h = model_height / stride;
-
-    for (int32_t idx = 0; idx < feature_h * feature_w; idx++) {
-        
-        const float* score = static_cast<const float*>(cls_pred.data);
-        int32_t row = idx / feature_h;
-        int32_t col = idx % feature_w;
-        float scoreMax = 0;
-        int32_t classIdMax = 0;
-        for (int32_t label = 0; label < NUM_CLASS; label++) {
-            //float currentScore = score[cls_pred.tensor_dims.width * label + idx];	/* memo: In ONNX model, H = label, W = pos(idx) */
-            float currentScore = score[cls_pred.tensor_dims[3] * idx + label];
-            if (currentScore > scoreMax) {
-                scoreMax = currentScore;
-                classIdMax = label;
-            }
-        }
-        if (scoreMax > threshold) {
-            Object object;
-            DisPred2Bbox(object, dis_pred, idx, col, row, stride);
-            object.x = (std::max)(object.x, 0.f);
-            object.y = (std::max)(object.y, 0.f);
-            object.width = (std::min)(object.width, model_width - object.x);
-            object.height = (std::min)(object.height, model_height - object.y);
-            object.class_id = classIdMax;
-            object.label = label_list_[object.class_id];
-            object.score = scoreMax;
-            object_list.push_back(object);
-        }
-    }
-    return kRetOk;
-}
-
-inline float fast_exp(float x)
+static inline float fast_exp(float x)
 {
     union {
         uint32_t i;
         float f;
     } v{};
-    v.i = static_cast<int32_t>((1 << 23) * (1.4426950409 * x + 126.93490512f));
+    v.i = static_cast<int32_t>((1 << 23) * (1.4426950409f * x + 126.93490512f));
     return v.f;
 }
 
-inline float sigmoid(float x)
+/* Max of class scores (0 if all scores are negative). Partial max values are kept in independent lanes so that the loop is vectorized (SSE / NEON) */
+static constexpr int32_t kSimdLane = 8;
+static inline float MaxScore(const float* score, int32_t length)
 {
-    return 1.0f / (1.0f + fast_exp(-x));
+    float lane_max[kSimdLane] = { 0 };
+    int32_t i = 0;
+    for (; i + kSimdLane <= length; i += kSimdLane) {
+#pragma omp simd
+        for (int32_t lane = 0; lane < kSimdLane; lane++) {
+            lane_max[lane] = (score[i + lane] > lane_max[lane]) ? score[i + lane] : lane_max[lane];
+        }
+    }
+    float score_max = 0;
+    for (int32_t lane = 0; lane < kSimdLane; lane++) {
+        score_max = (std::max)(score_max, lane_max[lane]);
+    }
+    for (; i < length; i++) {
+        score_max = (std::max)(score_max, score[i]);
+    }
+    return score_max;
 }
 
-template<typename _Tp>
-int32_t Activation_function_softmax(const _Tp* src, _Tp* dst, int32_t length)
+/* Expected value of softmax(src) over the bins [0, REG_MAX] (= sum(j * softmax(src)[j])) */
+static inline float DistributionIntegral(const float* src)
 {
-    const _Tp alpha = *std::max_element(src, src + length);
-    _Tp denominator{ 0 };
-
-    for (int32_t i = 0; i < length; ++i) {
-        dst[i] = fast_exp(src[i] - alpha);
-        denominator += dst[i];
+    float alpha = src[0];
+    for (int32_t j = 1; j < REG_MAX + 1; j++) {
+        alpha = (std::max)(alpha, src[j]);
     }
 
-    for (int32_t i = 0; i < length; ++i) {
-        dst[i] /= denominator;
+    float denominator = 0;
+    float numerator = 0;
+#pragma omp simd reduction(+:denominator, numerator)
+    for (int32_t j = 0; j < REG_MAX + 1; j++) {
+        float e = fast_exp(src[j] - alpha);
+        denominator += e;
+        numerator += e * j;
     }
+    return numerator / denominator;
+}
 
-    return 0;
+/* Original code: https://github.com/RangiLyu/nanodet/blob/main/demo_ncnn/nanodet.cpp */
+/* Only the max score is calculated for all cells. Class id and bounding box are calculated for cells over the threshold */
+void DetectionEngine::DecodeInfer(std::vector<Object>& object_list, const float* cls_pred, int32_t cls_pred_step, const float* dis_pred, int32_t dis_pred_step, float threshold, int32_t stride, int32_t model_width, int32_t model_height)
+{
+    int32_t feature_w = model_width / stride;
+    int32_t feature_h = model_height / stride;
+
+    for (int32_t idx = 0; idx < feature_h * feature_w; idx++) {
+        /* memo: In ONNX model, H = label, W = pos(idx). In ncnn model, H = pos(idx), W = label */
+        const float* score = cls_pred + cls_pred_step * idx;
+        float score_max = MaxScore(score, NUM_CLASS);
+        if (score_max <= threshold) continue;
+
+        Object object;
+        object.class_id = static_cast<int32_t>(std::find(score, score + NUM_CLASS, score_max) - score);
+        object.score = score_max;
+        DisPred2Bbox(object, dis_pred + dis_pred_step * idx, idx % feature_w, idx / feature_w, stride);
+        object.x = (std::max)(object.x, 0.f);
+        object.y = (std::max)(object.y, 0.f);
+        object.width = (std::min)(object.width, model_width - object.x);
+        object.height = (std::min)(object.height, model_height - object.y);
+        object_list.push_back(object);
+    }
 }
 
-void DetectionEngine::DisPred2Bbox(Object& object, const OutputTensorInfo& dis_pred_raw, int32_t idx, int32_t x, int32_t y, int32_t stride)
+void DetectionEngine::DisPred2Bbox(Object& object, const float* dis_pred, int32_t x, int32_t y, int32_t stride)
 {
     float ct_x = (x + 0.5f) * stride;
     float ct_y = (y + 0.5f) * stride;
-    std::vector<float> dis_pred;
-    dis_pred.resize(4);
-
-
+    float dis[4];
     for (int32_t i = 0; i < 4; i++) {
-        float dis = 0;
-        float dis_after_sm[REG_MAX + 1];
-        //activation_function_softmax(static_cast<float*>(dis_pred.data) + dis_pred.tensor_dims.width * (i * (REG_MAX + 1)) + idx, dis_after_sm, REG_MAX + 1);		/* memo: In ONNX model, H = label, W = pos(idx) */
-        Activation_function_softmax(static_cast<float*>(dis_pred_raw.data) + dis_pred_raw.tensor_dims[3] * idx + (i * (REG_MAX + 1)), dis_after_sm, REG_MAX + 1);
-        for (int32_t j = 0; j < REG_MAX + 1; j++) {
-            dis += j * dis_after_sm[j];
-        }
-        dis *= stride;
-        dis_pred[i] = dis;
+        dis[i] = DistributionIntegral(dis_pred + i * (REG_MAX + 1)) * stride;
     }
 
-    object.x = (std::max)(ct_x - dis_pred[0], 0.0f);
-    object.y = (std::max)(ct_y - dis_pred[1], 0.0f);
-    object.width = ct_x + dis_pred[2] - object.x;
-    object.height = ct_y + dis_pred[3] - object.y;
-
-    return;
+    object.x = (std::max)(ct_x - dis[0], 0.0f);
+    object.y = (std::max)(ct_y - dis[1], 0.0f);
+    object.width = ct_x + dis[2] - object.x;
+    object.height = ct_y + dis[3] - object.y;
 }
 
 float DetectionEngine::CalculateIoU(const Object& det0, const Object& det1)
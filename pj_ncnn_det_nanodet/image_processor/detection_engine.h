@@ -14,6 +14,7 @@
 
 /* for My modules */
 #include "inference_helper.h"
+#include "common_helper_cv.h"
 
 
 class DetectionEngine {
@@ -24,8 +25,7 @@ public:
     };
 
     typedef struct {
-        int32_t     class_id;
-        std::string label;
+        int32_t     class_id;   /* use GetLabel(class_id) to get the label */
         float       score;
         float       x;
         float       y;
@@ -43,16 +43,29 @@ public:
     } Result;
 
 public:
-    DetectionEngine() {}
+    static constexpr int32_t kMosaicTileMax = 9;  /* 3 x 3. Each tile gets too small for more ROIs */
+
+public:
+    DetectionEngine() : is_rgb_(true), input_width_(0), input_height_(0) {}
     ~DetectionEngine() {}
-    int32_t Initialize(const std::string& work_dir, const int32_t num_threads);
+    int32_t Initialize(const std::string& work_dir, const int32_t num_threads, const int32_t num_warmup = 0);
     int32_t Finalize(void);
     int32_t Process(const cv::Mat& original_mat, Result& result);
+    /* Run detection only on roi_list (e.g. areas around tracked objects) packed into one input image. Falls back to Process when there are too many ROIs */
+    int32_t ProcessMosaic(const cv::Mat& original_mat, const std::vector<cv::Rect>& roi_list, Result& result);
+    /* Change the model input size. Width and height must be multiples of the max stride. Can be called before Initialize or between frames */
+    int32_t SetInputSize(int32_t width, int32_t height);
+    const std::string& GetLabel(int32_t class_id) const { return label_list_[class_id]; }
+
+    /* Decode cls_pred (feature_h * feature_w * num_class) and dis_pred (feature_h * feature_w * 4 * (REG_MAX + 1)). cls_pred_step and dis_pred_step are the number of elements per cell */
+    static void DecodeInfer(std::vector<Object>& object_list, const float* cls_pred, int32_t cls_pred_step, const float* dis_pred, int32_t dis_pred_step, float threshold, int32_t stride, int32_t model_width, int32_t model_height);
 
 private:
+    int32_t Warmup(int32_t num_warmup);
     int32_t ReadLabel(const std::string& filename, std::vector<std::string>& label_list);
-    int32_t DecodeInfer(std::vector<Object>& object_list, const OutputTensorInfo& cls_pred, const OutputTensorInfo& dis_pred, double threshold, int32_t stride, int32_t model_width, int32_t model_height);
-    void DisPred2Bbox(Object& object, const OutputTensorInfo& dis_pred, int32_t idx, int32_t x, int32_t y, int32_t stride);
+    int32_t PreProcessImage(const cv::Mat& img_src);
+    void DecodeOutput(std::vector<Object>& object_list);
+    static void DisPred2Bbox(Object& object, const float* dis_pred, int32_t x, int32_t y, int32_t stride);
     void Nms(std::vector<Object>& object_list, std::vector<Object>& object_list_nms, bool use_weight);
     float CalculateIoU(const Object& det0, const Object& det1);
 
@@ -61,6 +74,15 @@ private:
     std::vector<InputTensorInfo> input_tensor_info_list_;
     std::vector<OutputTensorInfo> output_tensor_info_list_;
     std::vector<std::string> label_list_;
+    bool is_rgb_;
+    int32_t input_width_;   /* 0: use INPUT_DIMS */
+    int32_t input_height_;
+
+    /* work buffers reused for each frame to avoid allocation */
+    std::vector<Object> object_list_;
+    std::vector<Object> object_list_nms_;
+    std::vector<CommonHelper::MosaicTile> mosaic_tile_list_;
+    cv::Mat mosaic_image_;
 };
 
 #endif
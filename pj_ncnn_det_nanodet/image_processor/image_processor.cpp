@@ -18,7 +18,10 @@
 /* for My modules */
 #include "common_helper.h"
 #include "common_helper_cv.h"
+#include "thread_placement.h"
+#include "bounding_box.h"
 #include "detection_engine.h"
+#include "tracker.h"
 #include "image_processor.h"
 
 /*** Macro ***/
@@ -26,8 +29,18 @@
 #define PRINT(...)   COMMON_HELPER_PRINT(TAG, __VA_ARGS__)
 #define PRINT_E(...) COMMON_HELPER_PRINT_E(TAG, __VA_ARGS__)
 
+#define ROI_MARGIN_RATIO            0.5f    /* ROI for refinement = track's bbox + margin (ratio to the box size) on each side */
+
 /*** Global variable ***/
 std::unique_ptr<DetectionEngine> s_engine;
+ThreadPlacement s_thread_placement;
+Tracker s_tracker;
+int32_t s_detection_interval = 1;
+int32_t s_frame_cnt_from_detection = 0;
+bool s_is_roi_refinement = false;
+std::vector<cv::Rect> s_roi_list;
+std::vector<BoundingBox> s_bbox_pred_list;
+std::vector<BoundingBox> s_bbox_det_list;
 
 /*** Function ***/
 static void DrawFps(cv::Mat& mat, double time_inference, cv::Point pos, double font_scale, int32_t thickness, cv::Scalar color_front, cv::Scalar color_back, bool is_text_on_rect = true)
@@ -41,6 +54,20 @@ static void DrawFps(cv::Mat& mat, double time_inference, cv::Point pos, double f
     CommonHelper::DrawText(mat, text, cv::Point(0, 0), 0.5, 2, CommonHelper::CreateCvColor(0, 0, 0), CommonHelper::CreateCvColor(180, 180, 180), true);
 }
 
+/* Create ROIs around the predicted position of tracks for refinement */
+static void CreateRoiList(const std::vector<BoundingBox>& bbox_pred_list, int32_t image_w, int32_t image_h, std::vector<cv::Rect>& roi_list)
+{
+    roi_list.clear();
+    const cv::Rect image_rect(0, 0, image_w, image_h);
+    for (const auto& bbox : bbox_pred_list) {
+        int32_t margin_x = static_cast<int32_t>(bbox.w * ROI_MARGIN_RATIO);
+        int32_t margin_y = static_cast<int32_t>(bbox.h * ROI_MARGIN_RATIO);
+        cv::Rect roi = cv::Rect(bbox.x - margin_x, bbox.y - margin_y, bbox.w + margin_x * 2, bbox.h + margin_y * 2) & image_rect;
+        if (roi.width <= 0 || roi.height <= 0) continue;
+        roi_list.push_back(roi);
+    }
+}
+
 int32_t ImageProcessor::Initialize(const InputParam& input_param)
 {
     if (s_engine) {
@@ -48,12 +75,28 @@ int32_t ImageProcessor::Initialize(const InputParam& input_param)
         return -1;
     }
 
+    if (s_thread_placement.Initialize(input_param.cpu_affinity, input_param.num_threads) != ThreadPlacement::kRetOk) {
+        return -1;
+    }
+    s_thread_placement.Apply();
+
     s_engine.reset(new DetectionEngine());
-    if (s_engine->Initialize(input_param.work_dir, input_param.num_threads) != DetectionEngine::kRetOk) {
+    if (input_param.input_width > 0 && input_param.input_height > 0) {
+        if (s_engine->SetInputSize(input_param.input_width, input_param.input_height) != DetectionEngine::kRetOk) {
+            s_engine.reset();
+            return -1;
+        }
+    }
+    if (s_engine->Initialize(input_param.work_dir, s_thread_placement.GetThreadNum(), input_param.num_warmup) != DetectionEngine::kRetOk) {
         s_engine->Finalize();
         s_engine.reset();
         return -1;
     }
+
+    s_tracker.Reset();
+    s_detection_interval = (std::max)(input_param.detection_interval, 1);
+    s_frame_cnt_from_detection = 0;
+    s_is_roi_refinement = input_param.is_roi_refinement != 0;
     return 0;
 }
 
@@ -88,24 +131,70 @@ int32_t ImageProcessor::Command(int32_t cmd)
 }
 
 
+int32_t ImageProcessor::SetInputSize(int32_t width, int32_t height)
+{
+    if (!s_engine) {
+        PRINT_E("Not initialized\n");
+        return -1;
+    }
+    if (s_engine->SetInputSize(width, height) != DetectionEngine::kRetOk) {
+        return -1;
+    }
+    return 0;
+}
+
+
 int32_t ImageProcessor::Process(cv::Mat& mat, Result& result)
 {
     if (!s_engine) {
         PRINT_E("Not initialized\n");
         return -1;
     }
+    s_thread_placement.Apply();
+
+    /* Run detection on the full frame every s_detection_interval frames. The other frames run detection only around the positions where the tracks are predicted */
+    bool is_roi_frame = false;
+    if (s_is_roi_refinement && s_frame_cnt_from_detection + 1 < s_detection_interval) {
+        s_tracker.GetPredictedBoundingBoxList(s_bbox_pred_list);
+        CreateRoiList(s_bbox_pred_list, mat.cols, mat.rows, s_roi_list);
+        /* Detect on the full frame when there is no track, or too many tracks to pack (rather than losing the tracks) */
+        is_roi_frame = !s_roi_list.empty() && static_cast<int32_t>(s_roi_list.size()) <= DetectionEngine::kMosaicTileMax;
+    }
 
     DetectionEngine::Result det_result;
     det_result.object_list.clear();
-    if (s_engine->Process(mat, det_result) != DetectionEngine::kRetOk) {
-        return -1;
+    if (is_roi_frame) {
+        if (s_engine->ProcessMosaic(mat, s_roi_list, det_result) != DetectionEngine::kRetOk) {
+            return -1;
+        }
+        s_frame_cnt_from_detection++;
+    } else {
+        if (s_engine->Process(mat, det_result) != DetectionEngine::kRetOk) {
+            return -1;
+        }
+        s_frame_cnt_from_detection = 0;
+    }
+
+    /* Update tracks, so that ROIs at the next frame follow the objects */
+    if (s_is_roi_refinement) {
+        s_bbox_det_list.clear();
+        for (const auto& object : det_result.object_list) {
+            s_bbox_det_list.push_back(BoundingBox(object.class_id, object.score, static_cast<int32_t>(object.x), static_cast<int32_t>(object.y), static_cast<int32_t>(object.width), static_cast<int32_t>(object.height)));
+        }
+        s_tracker.Update(s_bbox_det_list);
     }
 
     /* Draw the result */
+    if (is_roi_frame) {
+        for (const auto& roi : s_roi_list) {
+            cv::rectangle(mat, roi, CommonHelper::CreateCvColor(0, 0, 0), 1);
+        }
+    }
     for (const auto& object : det_result.object_list) {
+        const std::string& label = s_engine->GetLabel(object.class_id);
         cv::rectangle(mat, cv::Rect(static_cast<int32_t>(object.x), static_cast<int32_t>(object.y), static_cast<int32_t>(object.width), static_cast<int32_t>(object.height)), cv::Scalar(255, 255, 0), 3);
-        cv::putText(mat, object.label, cv::Point(static_cast<int32_t>(object.x), static_cast<int32_t>(object.y) + 10), cv::FONT_HERSHEY_PLAIN, 1, CommonHelper::CreateCvColor(0, 0, 0), 3);
-        cv::putText(mat, object.label, cv::Point(static_cast<int32_t>(object.x), static_cast<int32_t>(object.y) + 10), cv::FONT_HERSHEY_PLAIN, 1, CommonHelper::CreateCvColor(0, 255, 0), 1);
+        cv::putText(mat, label, cv::Point(static_cast<int32_t>(object.x), static_cast<int32_t>(object.y) + 10), cv::FONT_HERSHEY_PLAIN, 1, CommonHelper::CreateCvColor(0, 0, 0), 3);
+        cv::putText(mat, label, cv::Point(static_cast<int32_t>(object.x), static_cast<int32_t>(object.y) + 10), cv::FONT_HERSHEY_PLAIN, 1, CommonHelper::CreateCvColor(0, 255, 0), 1);
     }
 
     DrawFps(mat, det_result.time_inference, cv::Point(0, 0), 0.5, 2, CommonHelper::CreateCvColor(0, 0, 0), CommonHelper::CreateCvColor(180, 180, 180), true);
@@ -114,7 +203,7 @@ int32_t ImageProcessor::Process(cv::Mat& mat, Result& result)
     int32_t object_num = 0;
     for (const auto& object : det_result.object_list) {
         result.object_list[object_num].class_id = object.class_id;
-        snprintf(result.object_list[object_num].label, sizeof(result.object_list[object_num].label), "%s", object.label.c_str());
+        snprintf(result.object_list[object_num].label, sizeof(result.object_list[object_num].label), "%s", s_engine->GetLabel(object.class_id).c_str());
         result.object_list[object_num].score = object.score;
         result.object_list[object_num].x = static_cast<int32_t>(object.x);
         result.object_list[object_num].y = static_cast<int32_t>(object.y);
@@ -19,7 +19,13 @@ namespace ImageProcessor
 
 typedef struct {
     char     work_dir[256];
-    int32_t  num_threads;
+    int32_t  num_threads;       /* 0: the number of cores in cpu_affinity (all cores when not pinned) */
+    int32_t  num_warmup;        /* number of dummy inferences in Initialize (0: no warm-up) */
+    char     cpu_affinity[32];  /* Pin inference threads to cores. "": not pinned, "all", "big", "little", or core list (e.g. "4-7") */
+    int32_t  input_width;       /* model input size (0: default size of the model). Must be multiples of 32 */
+    int32_t  input_height;
+    int32_t  detection_interval;    /* Run detection on the full frame every N frames (0, 1: every frame). Used with is_roi_refinement */
+    int32_t  is_roi_refinement;     /* Run detection only on areas around tracks at the other frames */
 } InputParam;
 
 typedef struct {
@@ -42,6 +48,7 @@ int32_t Initialize(const InputParam& input_param);
 int32_t Process(cv::Mat& mat, Result& result);
 int32_t Finalize(void);
 int32_t Command(int32_t cmd);
+int32_t SetInputSize(int32_t width, int32_t height);     /* change the model input size between frames */
 
 }
 
@@ -0,0 +1,113 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+/*** Include ***/
+/* for general */
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <algorithm>
+
+/* for My modules */
+#include "allocation_counter.h"
+
+/*** Global variable ***/
+static bool s_is_counting = false;
+static int64_t s_allocation_cnt = 0;
+
+/*** Function ***/
+void AllocationCounter::Start()
+{
+    s_allocation_cnt = 0;
+    s_is_counting = true;
+}
+
+int64_t AllocationCounter::Stop()
+{
+    s_is_counting = false;
+    return s_allocation_cnt;
+}
+
+/*** Replaced operator new / delete ***/
+/* All the replaceable forms are replaced together, so that every new is paired with the matching delete */
+/* They are defined in this translation unit only, so that they are not inlined into callers (GCC warns free() on a pointer from new when inlined) */
+static void* CountedAlloc(size_t size) noexcept
+{
+    if (s_is_counting) s_allocation_cnt++;
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+void* operator new(size_t size)
+{
+    void* p = CountedAlloc(size);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size)
+{
+    void* p = CountedAlloc(size);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return CountedAlloc(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return CountedAlloc(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+
+#ifdef __cpp_aligned_new
+/* Over-aligned allocation. The pointer from malloc is stored just before the aligned block (aligned_alloc is not available on all platforms) */
+static void* CountedAllocAligned(size_t size, std::align_val_t alignment) noexcept
+{
+    const size_t align = (std::max)(static_cast<size_t>(alignment), sizeof(void*));
+    void* p_raw = CountedAlloc(size + align + sizeof(void*));
+    if (!p_raw) return nullptr;
+    uintptr_t address = (reinterpret_cast<uintptr_t>(p_raw) + sizeof(void*) + align - 1) & ~(static_cast<uintptr_t>(align) - 1);
+    reinterpret_cast<void**>(address)[-1] = p_raw;
+    return reinterpret_cast<void*>(address);
+}
+
+static void FreeAligned(void* p) noexcept
+{
+    if (p) std::free(reinterpret_cast<void**>(p)[-1]);
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+    void* p = CountedAllocAligned(size, alignment);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+    void* p = CountedAllocAligned(size, alignment);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return CountedAllocAligned(size, alignment); }
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return CountedAllocAligned(size, alignment); }
+void operator delete(void* p, std::align_val_t) noexcept { FreeAligned(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { FreeAligned(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { FreeAligned(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { FreeAligned(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { FreeAligned(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { FreeAligned(p); }
+#endif
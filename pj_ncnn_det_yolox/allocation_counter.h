@@ -0,0 +1,29 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef ALLOCATION_COUNTER_
+#define ALLOCATION_COUNTER_
+
+/* for general */
+#include <cstdint>
+
+/* Count of operator new calls (all the forms) between Start and Stop. Only for benchmarks */
+/* Linking allocation_counter.cpp replaces the global operator new / delete of the executable */
+class AllocationCounter {
+public:
+    static void Start();
+    static int64_t Stop();
+};
+
+#endif
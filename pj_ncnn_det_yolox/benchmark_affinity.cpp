@@ -0,0 +1,157 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+/* Benchmark for thread placement: latency variance of inference with and without pinning the inference threads */
+/* Background threads emulate capture and render threads (busy for a while, then sleep), which compete with the inference threads */
+/* usage: benchmark_affinity [cpu affinity (default: big)] [number of background threads (default: 2)] [image] */
+/*** Include ***/
+/* for general */
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <atomic>
+
+/* for OpenCV */
+#include <opencv2/opencv.hpp>
+
+/* for My modules */
+#include "thread_placement.h"
+#include "detection_engine.h"
+
+/*** Macro ***/
+#define WORK_DIR            RESOURCE_DIR
+#define DEFAULT_INPUT_IMAGE RESOURCE_DIR"/kite.jpg"
+#define DEFAULT_AFFINITY    "big"
+#define DEFAULT_LOAD_NUM    2
+#define NUM_WARMUP          2
+#define FRAME_NUM           200
+#define LOAD_BUSY_TIME      5       /* [msec] */
+#define LOAD_SLEEP_TIME     5       /* [msec] */
+
+/*** Function ***/
+static double Percentile(std::vector<double> list, double p)
+{
+    if (list.empty()) return 0;
+    size_t index = static_cast<size_t>(p * (list.size() - 1) + 0.5);
+    std::nth_element(list.begin(), list.begin() + index, list.end());
+    return list[index];
+}
+
+/* Emulate capture / render threads. They are pinned to core_list if not empty */
+class BackgroundLoad {
+public:
+    BackgroundLoad() : is_running_(false) {}
+    ~BackgroundLoad() { Stop(); }
+
+    void Start(int32_t num, const std::vector<int32_t>& core_list)
+    {
+        is_running_ = true;
+        for (int32_t i = 0; i < num; i++) {
+            thread_list_.push_back(std::thread([this, core_list]() {
+                if (!core_list.empty()) ThreadPlacement::SetCurrentThreadAffinity(core_list);
+                volatile double dummy = 0;
+                while (is_running_) {
+                    const auto& t0 = std::chrono::steady_clock::now();
+                    while (std::chrono::steady_clock::now() - t0 < std::chrono::milliseconds(LOAD_BUSY_TIME)) dummy = dummy + 1.0;
+                    std::this_thread::sleep_for(std::chrono::milliseconds(LOAD_SLEEP_TIME));
+                }
+            }));
+        }
+    }
+
+    void Stop()
+    {
+        is_running_ = false;
+        for (auto& thread : thread_list_) thread.join();
+        thread_list_.clear();
+    }
+
+private:
+    std::atomic<bool> is_running_;
+    std::vector<std::thread> thread_list_;
+};
+
+static bool Measure(const char* name, DetectionEngine& engine, const cv::Mat& image, int32_t load_num, const std::vector<int32_t>& load_core_list)
+{
+    BackgroundLoad load;
+    load.Start(load_num, load_core_list);
+    std::vector<double> time_list;
+    for (int32_t i = 0; i < FRAME_NUM; i++) {
+        DetectionEngine::Result result;
+        if (engine.Process(image, result) != DetectionEngine::kRetOk) return false;
+        time_list.push_back(result.time_inference);
+    }
+    load.Stop();
+
+    double mean = 0;
+    for (const auto& time : time_list) mean += time;
+    mean /= time_list.size();
+    double variance = 0;
+    for (const auto& time : time_list) variance += (time - mean) * (time - mean);
+    const double stddev = std::sqrt(variance / time_list.size());
+    printf("%-22s %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f\n", name, mean, stddev,
+        Percentile(time_list, 0.5), Percentile(time_list, 0.9), Percentile(time_list, 0.99), Percentile(time_list, 1.0));
+    return true;
+}
+
+int32_t main(int argc, char* argv[])
+{
+    const std::string affinity = (argc > 1) ? argv[1] : DEFAULT_AFFINITY;
+    const int32_t load_num = (argc > 2) ? std::atoi(argv[2]) : DEFAULT_LOAD_NUM;
+    const std::string input_name = (argc > 3) ? argv[3] : DEFAULT_INPUT_IMAGE;
+    cv::Mat image = cv::imread(input_name);
+    if (image.empty()) {
+        printf("Failed to read %s\n", input_name.c_str());
+        return -1;
+    }
+
+    ThreadPlacement thread_placement;
+    if (thread_placement.Initialize(affinity, 0) != ThreadPlacement::kRetOk || thread_placement.GetCoreList().empty()) {
+        printf("Invalid cpu affinity: %s\n", affinity.c_str());
+        return -1;
+    }
+    const int32_t num_threads = thread_placement.GetThreadNum();
+
+    /* Threads are created in Initialize (warm-up), and are not pinned yet */
+    DetectionEngine engine;
+    if (engine.Initialize(WORK_DIR, num_threads, NUM_WARMUP) != DetectionEngine::kRetOk) {
+        printf("Failed to initialize DetectionEngine\n");
+        return -1;
+    }
+
+    printf("cores: %d, inference threads: %d, background threads: %d, frames: %d\n", ThreadPlacement::GetCoreNum(), num_threads, load_num, FRAME_NUM);
+    printf("%-22s %10s %10s %10s %10s %10s %10s\n", "placement", "mean[ms]", "stddev", "p50", "p90", "p99", "max");
+    /* Pinning can't be undone, so not pinned case is measured first */
+    if (!Measure("not pinned", engine, image, load_num, {})) return -1;
+    if (thread_placement.Apply() != ThreadPlacement::kRetOk) {
+        printf("Failed to pin threads\n");
+        return -1;
+    }
+    if (!Measure("pinned", engine, image, load_num, {})) return -1;
+    const std::vector<int32_t> other_core_list = thread_placement.GetOtherCoreList();
+    if (!other_core_list.empty()) {
+        if (!Measure("pinned + isolated", engine, image, load_num, other_core_list)) return -1;
+    } else {
+        printf("pinned + isolated is skipped, because no core is left for background threads. Specify fewer cores (e.g. 0-3)\n");
+    }
+
+    engine.Finalize();
+    return 0;
+}
@@ -0,0 +1,115 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+/* Benchmark for assignment in Tracker: HungarianAlgorithm (Munkres) vs AssignmentSolver (shortest augmenting path) */
+/*** Include ***/
+/* for general */
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+/* for My modules */
+#include "hungarian_algorithm.h"
+#include "assignment_solver.h"
+
+/*** Macro ***/
+#define COST_MAX 1.0f
+
+/*** Function ***/
+/* IoU-like cost: most pairs are COST_MAX (no overlap) and a few are close to 0, like the cost matrix in Tracker */
+static void CreateCostMatrix(std::mt19937& engine, int32_t num_track, int32_t num_det, std::vector<float>& cost_matrix)
+{
+    std::uniform_real_distribution<float> dist_cost(0.0f, 0.7f);
+    std::uniform_int_distribution<int32_t> dist_neighbor(-2, 2);
+    cost_matrix.assign(num_track * num_det, COST_MAX);
+    for (int32_t i_track = 0; i_track < num_track; i_track++) {
+        for (int32_t k = 0; k < 3; k++) {
+            int32_t i_det = (std::min)((std::max)(i_track + dist_neighbor(engine), 0), num_det - 1);
+            cost_matrix[i_track * num_det + i_det] = dist_cost(engine);
+        }
+    }
+}
+
+static float CalculateTotalCost(const std::vector<float>& cost_matrix, int32_t num_track, int32_t num_det, const std::vector<int32_t>& det_index_for_track)
+{
+    float total = 0;
+    for (int32_t i_track = 0; i_track < num_track; i_track++) {
+        int32_t i_det = det_index_for_track[i_track];
+        if (i_det >= 0 && i_det < num_det) total += cost_matrix[i_track * num_det + i_det];
+    }
+    return total;
+}
+
+int32_t main(int argc, char* argv[])
+{
+    std::mt19937 engine(1234);
+    printf("%6s %6s %6s %14s %14s %8s\n", "track", "det", "loop", "munkres[ms]", "sap[ms]", "speedup");
+
+    for (int32_t num : { 10, 100, 1000 }) {
+        const int32_t num_track = num;
+        const int32_t num_det = num + num / 10;      /* rectangular (some new objects appear) */
+        const int32_t loop_num = num >= 1000 ? 1 : (num >= 100 ? 10 : 1000);
+        std::vector<float> cost_matrix;
+        CreateCostMatrix(engine, num_track, num_det, cost_matrix);
+
+        /* Munkres needs the padded squared matrix */
+        double time_munkres = 0;
+        std::vector<int32_t> det_index_for_track_munkres;
+        {
+            const int32_t size = (std::max)(num_track, num_det);
+            std::vector<std::vector<float>> cost_matrix_square(size, std::vector<float>(size, COST_MAX));
+            for (int32_t i_track = 0; i_track < num_track; i_track++) {
+                for (int32_t i_det = 0; i_det < num_det; i_det++) {
+                    cost_matrix_square[i_track][i_det] = cost_matrix[i_track * num_det + i_det];
+                }
+            }
+            for (int32_t loop = 0; loop < loop_num; loop++) {
+                std::vector<int32_t> track_index_for_det(size, -1);
+                det_index_for_track_munkres.assign(size, -1);
+                const auto& t0 = std::chrono::steady_clock::now();
+                HungarianAlgorithm<float> solver(cost_matrix_square);
+                solver.Solve(det_index_for_track_munkres, track_index_for_det);
+                const auto& t1 = std::chrono::steady_clock::now();
+                time_munkres += static_cast<std::chrono::duration<double>>(t1 - t0).count() * 1000.0;
+            }
+        }
+
+        double time_sap = 0;
+        std::vector<int32_t> det_index_for_track_sap;
+        std::vector<int32_t> track_index_for_det_sap;
+        AssignmentSolver<float> solver;
+        for (int32_t loop = 0; loop < loop_num; loop++) {
+            const auto& t0 = std::chrono::steady_clock::now();
+            solver.Solve(cost_matrix, num_track, num_det, det_index_for_track_sap, track_index_for_det_sap);
+            const auto& t1 = std::chrono::steady_clock::now();
+            time_sap += static_cast<std::chrono::duration<double>>(t1 - t0).count() * 1000.0;
+        }
+
+        /* Both are optimal, so the total cost must be the same (assignment itself may differ when costs tie) */
+        float cost_munkres = CalculateTotalCost(cost_matrix, num_track, num_det, det_index_for_track_munkres);
+        float cost_sap = CalculateTotalCost(cost_matrix, num_track, num_det, det_index_for_track_sap);
+        bool is_same = std::abs(cost_munkres - cost_sap) < 1e-3f * num;
+
+        printf("%6d %6d %6d %14.4f %14.4f %7.1fx %s\n", num_track, num_det, loop_num, time_munkres / loop_num, time_sap / loop_num,
+            time_munkres / time_sap, is_same ? "" : "(COST MISMATCH)");
+    }
+
+    return 0;
+}
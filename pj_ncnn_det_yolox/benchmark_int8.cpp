@@ -0,0 +1,138 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+/* Benchmark for int8 model: inference time and detection difference from fp32 model on the same images */
+/* The int8 model (yolox_int8.param/bin) is created with calibrate_int8 and ncnn2int8. Use images different from the calibration images */
+/*** Include ***/
+/* for general */
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+/* for OpenCV */
+#include <opencv2/opencv.hpp>
+
+/* for My modules */
+#include "bounding_box.h"
+#include "detection_engine.h"
+
+/*** Macro ***/
+#define WORK_DIR            RESOURCE_DIR
+#define DEFAULT_IMAGE_DIR   RESOURCE_DIR
+#define NUM_THREADS         4
+#define NUM_WARMUP          2
+#define LOOP_NUM            5       /* per image */
+#define IMAGE_NUM_MAX       100
+#define MATCH_IOU           0.5f
+
+/*** Function ***/
+typedef struct {
+    double time_inference;  /* [msec] total */
+    double time_total;      /* [msec] total */
+    int32_t process_num;
+} Time;
+
+static bool RunDetection(DetectionEngine& engine, const cv::Mat& image, DetectionEngine::Result& result, Time& time)
+{
+    for (int32_t i = 0; i < LOOP_NUM; i++) {
+        if (engine.Process(image, result) != DetectionEngine::kRetOk) return false;
+        time.time_inference += result.time_inference;
+        time.time_total += result.time_pre_process + result.time_inference + result.time_post_process;
+        time.process_num++;
+    }
+    return true;
+}
+
+int32_t main(int argc, char* argv[])
+{
+    const std::string image_dir = (argc > 1) ? argv[1] : DEFAULT_IMAGE_DIR;
+    std::vector<cv::String> image_filename_list;
+    cv::glob(image_dir + "/*.jpg", image_filename_list, false);
+    if (image_filename_list.size() > IMAGE_NUM_MAX) image_filename_list.resize(IMAGE_NUM_MAX);
+    if (image_filename_list.empty()) {
+        printf("No image (*.jpg) found in %s\n", image_dir.c_str());
+        return -1;
+    }
+
+    DetectionEngine engine_fp32;
+    DetectionEngine engine_int8;
+    engine_int8.SetInt8(true);
+    if (engine_fp32.Initialize(WORK_DIR, NUM_THREADS, NUM_WARMUP) != DetectionEngine::kRetOk) {
+        printf("Failed to initialize fp32 model\n");
+        return -1;
+    }
+    if (engine_int8.Initialize(WORK_DIR, NUM_THREADS, NUM_WARMUP) != DetectionEngine::kRetOk) {
+        printf("Failed to initialize int8 model. Create it with calibrate_int8 and ncnn2int8\n");
+        return -1;
+    }
+
+    /* Detections of fp32 model are the reference. A detection of int8 model matches when the class is the same and IoU >= MATCH_IOU */
+    Time time_fp32 = { 0, 0, 0 };
+    Time time_int8 = { 0, 0, 0 };
+    int32_t det_num_fp32 = 0;
+    int32_t det_num_int8 = 0;
+    int32_t match_num = 0;
+    double iou_sum = 0;
+    double score_diff_sum = 0;
+    for (const auto& image_filename : image_filename_list) {
+        cv::Mat image = cv::imread(image_filename);
+        if (image.empty()) continue;
+        DetectionEngine::Result result_fp32;
+        DetectionEngine::Result result_int8;
+        if (!RunDetection(engine_fp32, image, result_fp32, time_fp32) || !RunDetection(engine_int8, image, result_int8, time_int8)) {
+            printf("Failed to process %s\n", image_filename.c_str());
+            return -1;
+        }
+
+        det_num_fp32 += static_cast<int32_t>(result_fp32.bbox_list.size());
+        det_num_int8 += static_cast<int32_t>(result_int8.bbox_list.size());
+        std::vector<bool> is_used(result_int8.bbox_list.size(), false);
+        for (const auto& bbox_fp32 : result_fp32.bbox_list) {
+            int32_t index_best = -1;
+            float iou_best = MATCH_IOU;
+            for (size_t i = 0; i < result_int8.bbox_list.size(); i++) {
+                const auto& bbox_int8 = result_int8.bbox_list[i];
+                if (is_used[i] || bbox_int8.class_id != bbox_fp32.class_id) continue;
+                float iou = BoundingBoxUtils::CalculateIoU(bbox_fp32, bbox_int8);
+                if (iou >= iou_best) {
+                    iou_best = iou;
+                    index_best = static_cast<int32_t>(i);
+                }
+            }
+            if (index_best < 0) continue;
+            is_used[index_best] = true;
+            match_num++;
+            iou_sum += iou_best;
+            score_diff_sum += std::abs(result_int8.bbox_list[index_best].score - bbox_fp32.score);
+        }
+    }
+
+    printf("images: %zu, loop: %d, threads: %d\n", image_filename_list.size(), LOOP_NUM, NUM_THREADS);
+    printf("%-6s %16s %16s\n", "model", "inference[ms]", "total[ms]");
+    printf("%-6s %16.3f %16.3f\n", "fp32", time_fp32.time_inference / time_fp32.process_num, time_fp32.time_total / time_fp32.process_num);
+    printf("%-6s %16.3f %16.3f\n", "int8", time_int8.time_inference / time_int8.process_num, time_int8.time_total / time_int8.process_num);
+    printf("speed up (inference): %.2f x\n", time_fp32.time_inference / time_int8.time_inference);
+    printf("detections: fp32 = %d, int8 = %d, matched = %d\n", det_num_fp32, det_num_int8, match_num);
+    printf("recall against fp32: %.3f, precision against fp32: %.3f\n",
+        det_num_fp32 > 0 ? static_cast<double>(match_num) / det_num_fp32 : 0.0, det_num_int8 > 0 ? static_cast<double>(match_num) / det_num_int8 : 0.0);
+    printf("matched: mean IoU = %.3f, mean score diff = %.4f\n", match_num > 0 ? iou_sum / match_num : 0.0, match_num > 0 ? score_diff_sum / match_num : 0.0);
+
+    engine_fp32.Finalize();
+    engine_int8.Finalize();
+    return 0;
+}
@@ -0,0 +1,127 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+/* Benchmark for Kalman filter in Tracker: KalmanFilterFixed for each track vs KalmanFilterBatch (SoA) for all tracks */
+/*** Include ***/
+/* for general */
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+/* for My modules */
+#include "kalman_filter_fixed.h"
+#include "kalman_filter_batch.h"
+
+/*** Macro ***/
+#define NUM_STATUS  7
+#define NUM_OBSERVE 4
+#define FRAME_NUM   100
+
+typedef KalmanFilterFixed<NUM_STATUS, NUM_OBSERVE> KalmanFilter;
+typedef KalmanFilterBatch<NUM_STATUS, NUM_OBSERVE> KalmanFilterBatched;
+
+/*** Function ***/
+/* The same model as Tracker (uniform linear motion) */
+static void CreateModel(KalmanFilter::MatrixStatus& F, KalmanFilter::MatrixStatus& Q, KalmanFilter::MatrixObserveStatus& H, KalmanFilter::MatrixObserve& R, KalmanFilter::MatrixStatus& P0)
+{
+    F = KalmanFilter::MatrixStatus::IdentityMatrix();
+    F(0, 4) = 1;
+    F(1, 5) = 1;
+    F(2, 6) = 1;
+    Q = KalmanFilter::MatrixStatus::IdentityMatrix();
+    Q(4, 4) = 0.01;
+    Q(5, 5) = 0.01;
+    Q(6, 6) = 0.001;
+    H = KalmanFilter::MatrixObserveStatus();
+    for (int32_t i = 0; i < NUM_OBSERVE; i++) H(i, i) = 1;
+    R = KalmanFilter::MatrixObserve::IdentityMatrix();
+    R(2, 2) = 10;
+    R(3, 3) = 10;
+    P0 = KalmanFilter::MatrixStatus::IdentityMatrix();
+    for (int32_t i = 0; i < NUM_STATUS; i++) P0(i, i) *= 10;
+}
+
+int32_t main(int argc, char* argv[])
+{
+    KalmanFilter::MatrixStatus F, Q, P0;
+    KalmanFilter::MatrixObserveStatus H;
+    KalmanFilter::MatrixObserve R;
+    CreateModel(F, Q, H, R, P0);
+
+    printf("%6s %16s %16s %16s %16s %12s\n", "track", "predict[us]", "predict_batch[us]", "update[us]", "update_batch[us]", "max_diff");
+    for (int32_t num : { 10, 100, 500, 2000 }) {
+        std::mt19937 engine(1234);
+        std::uniform_real_distribution<double> dist_pos(0, 1000);
+        std::uniform_real_distribution<double> dist_noise(-2, 2);
+
+        std::vector<KalmanFilter> kf_list(num);
+        KalmanFilterBatched kf_batch;
+        kf_batch.Initialize(F, Q, H, R);
+        kf_batch.Reserve(num);
+        std::vector<KalmanFilter::VectorObserve> z_list(num);
+        std::vector<int32_t> index_list(num);
+        for (int32_t i = 0; i < num; i++) {
+            KalmanFilter::VectorStatus X0({ dist_pos(engine), dist_pos(engine), 2000, 0.5, 0, 0, 0 });
+            kf_list[i].Initialize(F, Q, H, R, X0, P0);
+            kf_batch.SetStatus(i, X0, P0);
+            index_list[i] = i;
+            z_list[i] = KalmanFilter::VectorObserve({ X0(0, 0), X0(1, 0), 2000, 0.5 });
+        }
+
+        double time_predict = 0, time_predict_batch = 0, time_update = 0, time_update_batch = 0;
+        for (int32_t frame = 0; frame < FRAME_NUM; frame++) {
+            const auto& t0 = std::chrono::steady_clock::now();
+            for (auto& kf : kf_list) kf.Predict();
+            const auto& t1 = std::chrono::steady_clock::now();
+            kf_batch.Predict(num);
+            const auto& t2 = std::chrono::steady_clock::now();
+
+            for (auto& z : z_list) {
+                z(0, 0) += 3 + dist_noise(engine);
+                z(1, 0) += 1 + dist_noise(engine);
+            }
+            const auto& t3 = std::chrono::steady_clock::now();
+            for (int32_t i = 0; i < num; i++) kf_list[i].Update(z_list[i]);
+            const auto& t4 = std::chrono::steady_clock::now();
+            kf_batch.Update(index_list.data(), z_list.data(), num);
+            const auto& t5 = std::chrono::steady_clock::now();
+
+            time_predict += static_cast<std::chrono::duration<double>>(t1 - t0).count() * 1e6;
+            time_predict_batch += static_cast<std::chrono::duration<double>>(t2 - t1).count() * 1e6;
+            time_update += static_cast<std::chrono::duration<double>>(t4 - t3).count() * 1e6;
+            time_update_batch += static_cast<std::chrono::duration<double>>(t5 - t4).count() * 1e6;
+        }
+
+        /* Compare status */
+        double max_diff = 0;
+        KalmanFilter::VectorStatus X;
+        KalmanFilter::MatrixStatus P;
+        for (int32_t i = 0; i < num; i++) {
+            kf_batch.GetStatus(i, X, P);
+            for (int32_t k = 0; k < NUM_STATUS; k++) max_diff = (std::max)(max_diff, std::abs(X.data_array[k] - kf_list[i].X.data_array[k]));
+            for (int32_t k = 0; k < NUM_STATUS * NUM_STATUS; k++) max_diff = (std::max)(max_diff, std::abs(P.data_array[k] - kf_list[i].P.data_array[k]));
+        }
+
+        printf("%6d %16.3f %16.3f %16.3f %16.3f %12.3e %s\n", num, time_predict / FRAME_NUM, time_predict_batch / FRAME_NUM,
+            time_update / FRAME_NUM, time_update_batch / FRAME_NUM, max_diff, max_diff < 1e-6 ? "" : "(MISMATCH)");
+    }
+
+    return 0;
+}
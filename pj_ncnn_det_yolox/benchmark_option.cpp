@@ -0,0 +1,244 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+/* Benchmark for ncnn compute options (fp16 / bf16 storage, fp16 arithmetic, packing layout, winograd, sgemm, light mode) */
+/* All the combinations are tried on a model, and sorted by inference time. The best one differs between CPUs (e.g. fp16 arithmetic is only for ARMv8.2) */
+/* Any ncnn model can be measured: benchmark_option [model base (without .param / .bin)] [input width input height] */
+/* Partial: this only measures the options. Selecting them in InputParam / the engines is still open, because InferenceHelper doesn't expose ncnn::Option (the engines run with its defaults) */
+/*** Include ***/
+/* for general */
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <set>
+#include <algorithm>
+#include <chrono>
+
+/* for ncnn */
+#include "net.h"
+#include "layer.h"
+
+/* for My modules */
+#include "yolov5_focus.h"
+
+/*** Macro ***/
+#define DEFAULT_MODEL_BASE  RESOURCE_DIR"/model/yolox"
+#define DEFAULT_WIDTH       640
+#define DEFAULT_HEIGHT      480
+#define NUM_THREADS         4
+#define NUM_WARMUP          2
+#define LOOP_NUM            10
+
+/*** Function ***/
+typedef struct {
+    bool use_fp16_storage;      /* with use_fp16_packed */
+    bool use_fp16_arithmetic;
+    bool use_bf16_storage;
+    bool use_packing_layout;
+    bool use_winograd_convolution;
+    bool use_sgemm_convolution;
+    bool lightmode;
+} ComputeOption;
+
+typedef struct {
+    ComputeOption option;
+    double time_load;       /* [msec] */
+    double time_inference;  /* [msec] average */
+    float max_diff;         /* max abs diff of the outputs from the reference (fp32 storage, no packing, no winograd, no sgemm) */
+    bool is_ok;
+} Record;
+
+static ncnn::Layer* CreateYoloV5Focus(void* /*userdata*/)
+{
+    return new YoloV5Focus;
+}
+
+static std::string ToString(const ComputeOption& option)
+{
+    std::string str;
+    str += option.use_fp16_storage ? (option.use_fp16_arithmetic ? "fp16+arith" : "fp16      ") : (option.use_bf16_storage ? "bf16      " : "fp32      ");
+    str += option.use_packing_layout ? " pack" : "     ";
+    str += option.use_winograd_convolution ? " winograd" : "         ";
+    str += option.use_sgemm_convolution ? " sgemm" : "      ";
+    str += option.lightmode ? " light" : "      ";
+    return str;
+}
+
+/* fp16 arithmetic needs fp16 storage, and bf16 storage is not used together with fp16 storage */
+static std::vector<ComputeOption> CreateOptionList()
+{
+    std::vector<ComputeOption> option_list;
+    for (int32_t flag = 0; flag < (1 << 7); flag++) {
+        ComputeOption option;
+        option.use_fp16_storage = (flag & (1 << 0)) != 0;
+        option.use_fp16_arithmetic = (flag & (1 << 1)) != 0;
+        option.use_bf16_storage = (flag & (1 << 2)) != 0;
+        option.use_packing_layout = (flag & (1 << 3)) != 0;
+        option.use_winograd_convolution = (flag & (1 << 4)) != 0;
+        option.use_sgemm_convolution = (flag & (1 << 5)) != 0;
+        option.lightmode = (flag & (1 << 6)) != 0;
+        if (option.use_fp16_arithmetic && !option.use_fp16_storage) continue;
+        if (option.use_bf16_storage && option.use_fp16_storage) continue;
+        option_list.push_back(option);
+    }
+    return option_list;
+}
+
+/* Outputs are the blobs which are not consumed by any layer */
+static void FindInputOutput(const ncnn::Net& net, int32_t& input_blob, std::vector<int32_t>& output_blob_list)
+{
+    std::set<int32_t> consumed_blob_set;
+    input_blob = -1;
+    for (const ncnn::Layer* layer : net.layers()) {
+        if (layer->type == "Input") input_blob = layer->tops[0];
+        consumed_blob_set.insert(layer->bottoms.begin(), layer->bottoms.end());
+    }
+    output_blob_list.clear();
+    for (const ncnn::Layer* layer : net.layers()) {
+        for (const auto& top : layer->tops) {
+            if (consumed_blob_set.count(top) == 0) output_blob_list.push_back(top);
+        }
+    }
+}
+
+static bool Run(const std::string& model_base, const ncnn::Mat& in, Record& record, std::vector<std::vector<float>>& output_list)
+{
+    ncnn::Net net;
+    net.opt.num_threads = NUM_THREADS;
+    net.opt.use_fp16_storage = record.option.use_fp16_storage;
+    net.opt.use_fp16_packed = record.option.use_fp16_storage;
+    net.opt.use_fp16_arithmetic = record.option.use_fp16_arithmetic;
+    net.opt.use_bf16_storage = record.option.use_bf16_storage;
+    net.opt.use_packing_layout = record.option.use_packing_layout;
+    net.opt.use_winograd_convolution = record.option.use_winograd_convolution;
+    net.opt.use_sgemm_convolution = record.option.use_sgemm_convolution;
+    net.opt.lightmode = record.option.lightmode;
+    net.register_custom_layer("YoloV5Focus", CreateYoloV5Focus);
+
+    const auto& t_load0 = std::chrono::steady_clock::now();
+    if (net.load_param((model_base + ".param").c_str()) != 0 || net.load_model((model_base + ".bin").c_str()) != 0) {
+        return false;
+    }
+    const auto& t_load1 = std::chrono::steady_clock::now();
+    record.time_load = static_cast<std::chrono::duration<double>>(t_load1 - t_load0).count() * 1000.0;
+
+    int32_t input_blob = -1;
+    std::vector<int32_t> output_blob_list;
+    FindInputOutput(net, input_blob, output_blob_list);
+    if (input_blob < 0 || output_blob_list.empty()) {
+        return false;
+    }
+
+    double time_inference = 0;
+    for (int32_t i = 0; i < NUM_WARMUP + LOOP_NUM; i++) {
+        const auto& t0 = std::chrono::steady_clock::now();
+        ncnn::Extractor ex = net.create_extractor();
+        ex.input(input_blob, in);
+        std::vector<ncnn::Mat> out_list(output_blob_list.size());
+        for (size_t k = 0; k < output_blob_list.size(); k++) {
+            if (ex.extract(output_blob_list[k], out_list[k]) != 0) return false;
+        }
+        const auto& t1 = std::chrono::steady_clock::now();
+        if (i >= NUM_WARMUP) time_inference += static_cast<std::chrono::duration<double>>(t1 - t0).count() * 1000.0;
+
+        if (i == 0) {
+            /* Extracted Mat is unpacked and converted to fp32 */
+            output_list.resize(out_list.size());
+            for (size_t k = 0; k < out_list.size(); k++) {
+                const ncnn::Mat& out = out_list[k];
+                output_list[k].clear();
+                for (int32_t c = 0; c < out.c; c++) {
+                    const float* data = out.channel(c);
+                    output_list[k].insert(output_list[k].end(), data, data + out.w * out.h);
+                }
+            }
+        }
+    }
+    record.time_inference = time_inference / LOOP_NUM;
+    return true;
+}
+
+static float CalculateMaxDiff(const std::vector<std::vector<float>>& output_list, const std::vector<std::vector<float>>& reference_list)
+{
+    if (output_list.size() != reference_list.size()) return INFINITY;
+    float max_diff = 0;
+    for (size_t k = 0; k < output_list.size(); k++) {
+        if (output_list[k].size() != reference_list[k].size()) return INFINITY;
+        for (size_t i = 0; i < output_list[k].size(); i++) max_diff = (std::max)(max_diff, std::abs(output_list[k][i] - reference_list[k][i]));
+    }
+    return max_diff;
+}
+
+int32_t main(int argc, char* argv[])
+{
+    /* Width and height are given together */
+    const int32_t width = (argc > 3) ? std::atoi(argv[2]) : DEFAULT_WIDTH;
+    const int32_t height = (argc > 3) ? std::atoi(argv[3]) : DEFAULT_HEIGHT;
+    if (argc == 3 || argc > 4 || width <= 0 || height <= 0) {
+        printf("usage: %s [model base (without .param / .bin)] [input width input height]\n", argv[0]);
+        return -1;
+    }
+    const std::string model_base = (argc > 1) ? argv[1] : DEFAULT_MODEL_BASE;
+
+    /* The same pseudo random input for all the options */
+    ncnn::Mat in(width, height, 3);
+    for (int32_t c = 0; c < in.c; c++) {
+        float* data = in.channel(c);
+        for (int32_t i = 0; i < width * height; i++) data[i] = static_cast<float>((i * 7 + c * 13) % 256) / 255.0f;
+    }
+
+    std::vector<Record> record_list;
+    std::vector<std::vector<float>> reference_list;
+    for (const auto& option : CreateOptionList()) {
+        Record record;
+        record.option = option;
+        record.time_load = 0;
+        record.time_inference = 0;
+        record.max_diff = 0;
+        std::vector<std::vector<float>> output_list;
+        record.is_ok = Run(model_base, in, record, output_list);
+        if (record.is_ok) {
+            /* The first option (all off) is the reference */
+            if (reference_list.empty()) reference_list = output_list;
+            record.max_diff = CalculateMaxDiff(output_list, reference_list);
+        }
+        printf("\r%zu options done", record_list.size() + 1);
+        fflush(stdout);
+        record_list.push_back(record);
+    }
+    printf("\n");
+    if (reference_list.empty()) {
+        printf("Failed to run %s(.param, .bin)\n", model_base.c_str());
+        return -1;
+    }
+
+    std::stable_sort(record_list.begin(), record_list.end(), [](const Record& lhs, const Record& rhs) {
+        if (lhs.is_ok != rhs.is_ok) return lhs.is_ok;
+        return lhs.time_inference < rhs.time_inference;
+    });
+    printf("model: %s, input: %d x %d, threads: %d\n", model_base.c_str(), width, height, NUM_THREADS);
+    printf("%-42s %12s %14s %12s\n", "option", "load[ms]", "inference[ms]", "max_diff");
+    for (const auto& record : record_list) {
+        if (!record.is_ok) {
+            printf("%-42s failed\n", ToString(record.option).c_str());
+            continue;
+        }
+        printf("%-42s %12.3f %14.3f %12.3e\n", ToString(record.option).c_str(), record.time_load, record.time_inference, record.max_diff);
+    }
+    printf("max_diff: max abs diff of the outputs from fp32 without packing, winograd and sgemm\n");
+    return 0;
+}
@@ -0,0 +1,136 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+/* Benchmark for model loading time of ncnn: text param + bin file vs binary param + bin file vs binary param + memory mapped bin (zero copy) vs bundle */
+/* Binary param (*.param.bin) is created by ncnn2mem in ncnn tools: ncnn2mem yolox.param yolox.bin yolox.id.h yolox.mem.h */
+/*** Include ***/
+/* for general */
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+
+/* for ncnn */
+#include "net.h"
+#include "layer.h"
+
+/* for My modules */
+#include "mapped_file.h"
+#include "model_bundle.h"
+
+/*** Macro ***/
+#define DEFAULT_MODEL_BASE  RESOURCE_DIR"/model/yolox"
+#define LOOP_NUM            10
+
+/*** Custom layer ***/
+/* The model uses YoloV5Focus (implemented in DetectionEngine). Only loading is measured here, so a layer without forward is enough */
+class YoloV5FocusPlaceholder : public ncnn::Layer {
+};
+DEFINE_LAYER_CREATOR(YoloV5FocusPlaceholder)
+
+/*** Function ***/
+/* Memory referenced by ncnn::Net. It must be kept while net is used (weights are referenced, not copied) */
+typedef struct {
+    MappedFile  param;
+    MappedFile  model;
+    ModelBundle bundle;
+} MappedMemory;
+
+static bool IsFileExist(const std::string& filename)
+{
+    std::ifstream ifs(filename);
+    return !ifs.fail();
+}
+
+/* Load the model LOOP_NUM times with a new ncnn::Net, and print the first (cold) and the average of the rest (warm) */
+template<typename LOAD_FUNC>
+static void Measure(const char* name, LOAD_FUNC load_func)
+{
+    double time_cold = 0;
+    double time_warm = 0;
+    for (int32_t i = 0; i < LOOP_NUM; i++) {
+        MappedMemory mapped_memory;     /* declared before net, so that it's destructed after net */
+        ncnn::Net net;
+        net.register_custom_layer("YoloV5Focus", YoloV5FocusPlaceholder_layer_creator);
+        const auto& t0 = std::chrono::steady_clock::now();
+        if (!load_func(net, mapped_memory)) {
+            printf("%-24s failed to load\n", name);
+            return;
+        }
+        const auto& t1 = std::chrono::steady_clock::now();
+        double time = static_cast<std::chrono::duration<double>>(t1 - t0).count() * 1000.0;
+        if (i == 0) {
+            time_cold = time;
+        } else {
+            time_warm += time;
+        }
+    }
+    printf("%-24s %12.3f %12.3f\n", name, time_cold, time_warm / (LOOP_NUM - 1));
+}
+
+int32_t main(int argc, char* argv[])
+{
+    /* model base name (without extension). e.g. resource/model/yolox for yolox.param, yolox.bin, yolox.param.bin */
+    const std::string model_base = (argc > 1) ? argv[1] : DEFAULT_MODEL_BASE;
+    const std::string param_filename = model_base + ".param";
+    const std::string param_bin_filename = model_base + ".param.bin";
+    const std::string model_filename = model_base + ".bin";
+    const std::string bundle_filename = model_base + "_full.bundle";    /* bundle with param and bin sections */
+    if (!IsFileExist(param_filename) || !IsFileExist(model_filename)) {
+        printf("Model not found: %s(.param, .bin)\n", model_base.c_str());
+        return -1;
+    }
+
+    /* Note: the first load includes reading files into the OS file cache unless it's already cached */
+    printf("%-24s %12s %12s\n", "method", "cold[ms]", "warm[ms]");
+    Measure("text param + bin", [&](ncnn::Net& net, MappedMemory&) {
+        return net.load_param(param_filename.c_str()) == 0 && net.load_model(model_filename.c_str()) == 0;
+    });
+
+    if (IsFileExist(bundle_filename)) {
+        /* One file is mapped. The param section is text, and is terminated by '\0' */
+        Measure("bundle (text param)", [&](ncnn::Net& net, MappedMemory& mapped_memory) {
+            ModelBundle& bundle = mapped_memory.bundle;
+            if (bundle.Open(bundle_filename) != ModelBundle::kRetOk) return false;
+            const uint8_t* param = nullptr;
+            const uint8_t* model = nullptr;
+            size_t param_size = 0;
+            size_t model_size = 0;
+            if (!bundle.GetSection("param", param, param_size) || !bundle.GetSection("bin", model, model_size)) return false;
+            return net.load_param_mem(reinterpret_cast<const char*>(param)) == 0 && net.load_model(model) > 0;
+        });
+    } else {
+        printf("%s is not found. Create it with create_model_bundle (param=, bin=) to measure bundle\n", bundle_filename.c_str());
+    }
+
+    if (!IsFileExist(param_bin_filename)) {
+        printf("%s is not found. Create it with ncnn2mem to measure binary param\n", param_bin_filename.c_str());
+        return 0;
+    }
+    Measure("binary param + bin", [&](ncnn::Net& net, MappedMemory&) {
+        return net.load_param_bin(param_bin_filename.c_str()) == 0 && net.load_model(model_filename.c_str()) == 0;
+    });
+    Measure("binary param + mmap", [&](ncnn::Net& net, MappedMemory& mapped_memory) {
+        if (mapped_memory.param.Open(param_bin_filename) != MappedFile::kRetOk) return false;
+        if (mapped_memory.model.Open(model_filename) != MappedFile::kRetOk) return false;
+        /* Both return consumed bytes. Weights are referenced from the mapped memory without copy */
+        return net.load_param(mapped_memory.param.GetData()) > 0 && net.load_model(mapped_memory.model.GetData()) > 0;
+    });
+
+    return 0;
+}
@@ -0,0 +1,214 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+/* Benchmark for Tracker::Update with synthetic multi-object scenes (births, deaths, occlusions and jitter). No model is needed */
+/*** Include ***/
+/* for general */
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <unordered_map>
+
+/* for My modules */
+#include "bounding_box.h"
+#include "tracker.h"
+#include "allocation_counter.h"
+
+/*** Macro ***/
+#define IMAGE_WIDTH         3840
+#define IMAGE_HEIGHT        2160
+#define FRAME_NUM           300
+#define BOX_SIZE_MIN        24
+#define BOX_SIZE_MAX        96
+#define SPEED_MAX           4.0f    /* [px/frame] */
+#define JITTER              2.0f    /* [px] noise added to detected box */
+#define LIFETIME_MIN        60      /* [frame] an object disappears after its lifetime, and a new object appears instead */
+#define LIFETIME_MAX        600
+#define MISS_RATE           0.03f   /* probability that an object is not detected at a frame */
+#define OCCLUSION_RATE      0.005f  /* probability that an object starts to be occluded (not detected for several frames) */
+#define OCCLUSION_FRAME_MAX 15
+#define FALSE_POSITIVE_RATE 0.01f   /* number of false detections per object per frame */
+
+/*** Scene ***/
+typedef struct {
+    int32_t gt_id;
+    float   x;
+    float   y;
+    float   w;
+    float   h;
+    float   vx;
+    float   vy;
+    int32_t life;
+    int32_t occluded;   /* remaining frames of occlusion */
+} Object;
+
+class Scene {
+public:
+    Scene(int32_t num, uint32_t seed) : engine_(seed), gt_id_next_(0)
+    {
+        for (int32_t i = 0; i < num; i++) object_list_.push_back(CreateObject());
+    }
+
+    /* Move objects and create detections. The GT ID of each detection is stored in gt_id_list (-1: false positive) */
+    void Step(std::vector<BoundingBox>& det_list, std::vector<int32_t>& gt_id_list)
+    {
+        std::uniform_real_distribution<float> dist_01(0.0f, 1.0f);
+        std::uniform_real_distribution<float> dist_jitter(-JITTER, JITTER);
+        std::uniform_int_distribution<int32_t> dist_occlusion(2, OCCLUSION_FRAME_MAX);
+        det_list.clear();
+        gt_id_list.clear();
+        for (auto& object : object_list_) {
+            /* Death and birth */
+            if (--object.life <= 0) object = CreateObject();
+
+            /* Motion (bounce at the edge) */
+            object.x += object.vx;
+            object.y += object.vy;
+            if (object.x < 0 || object.x + object.w > IMAGE_WIDTH) object.vx = -object.vx;
+            if (object.y < 0 || object.y + object.h > IMAGE_HEIGHT) object.vy = -object.vy;
+
+            /* Occlusion and miss */
+            if (object.occluded > 0) {
+                object.occluded--;
+                continue;
+            }
+            if (dist_01(engine_) < OCCLUSION_RATE) {
+                object.occluded = dist_occlusion(engine_);
+                continue;
+            }
+            if (dist_01(engine_) < MISS_RATE) continue;
+
+            det_list.push_back(BoundingBox(0, 0.9f,
+                static_cast<int32_t>(object.x + dist_jitter(engine_)), static_cast<int32_t>(object.y + dist_jitter(engine_)),
+                static_cast<int32_t>(object.w + dist_jitter(engine_)), static_cast<int32_t>(object.h + dist_jitter(engine_))));
+            gt_id_list.push_back(object.gt_id);
+        }
+
+        /* False positives */
+        std::uniform_int_distribution<int32_t> dist_x(0, IMAGE_WIDTH - BOX_SIZE_MAX);
+        std::uniform_int_distribution<int32_t> dist_y(0, IMAGE_HEIGHT - BOX_SIZE_MAX);
+        std::uniform_int_distribution<int32_t> dist_size(BOX_SIZE_MIN, BOX_SIZE_MAX);
+        int32_t num_fp = static_cast<int32_t>(object_list_.size() * FALSE_POSITIVE_RATE + dist_01(engine_));
+        for (int32_t i = 0; i < num_fp; i++) {
+            det_list.push_back(BoundingBox(0, 0.5f, dist_x(engine_), dist_y(engine_), dist_size(engine_), dist_size(engine_)));
+            gt_id_list.push_back(-1);
+        }
+    }
+
+private:
+    Object CreateObject()
+    {
+        std::uniform_real_distribution<float> dist_size(BOX_SIZE_MIN, BOX_SIZE_MAX);
+        std::uniform_real_distribution<float> dist_speed(-SPEED_MAX, SPEED_MAX);
+        std::uniform_int_distribution<int32_t> dist_life(LIFETIME_MIN, LIFETIME_MAX);
+        Object object;
+        object.gt_id = gt_id_next_++;
+        object.w = dist_size(engine_);
+        object.h = dist_size(engine_) * 2;    /* person-like aspect */
+        std::uniform_real_distribution<float> dist_x(0, IMAGE_WIDTH - object.w);
+        std::uniform_real_distribution<float> dist_y(0, IMAGE_HEIGHT - object.h);
+        object.x = dist_x(engine_);
+        object.y = dist_y(engine_);
+        object.vx = dist_speed(engine_);
+        object.vy = dist_speed(engine_);
+        object.life = dist_life(engine_);
+        object.occluded = 0;
+        return object;
+    }
+
+private:
+    std::mt19937 engine_;
+    int32_t gt_id_next_;
+    std::vector<Object> object_list_;
+};
+
+/*** Function ***/
+static double Percentile(std::vector<double> list, double p)
+{
+    if (list.empty()) return 0;
+    size_t index = static_cast<size_t>(p * (list.size() - 1) + 0.5);
+    std::nth_element(list.begin(), list.begin() + index, list.end());
+    return list[index];
+}
+
+/* Key to find the detection which a track is updated with (Track keeps the raw detection) */
+static inline uint64_t BboxKey(const BoundingBox& bbox)
+{
+    return (static_cast<uint64_t>(bbox.x & 0xFFFF) << 48) | (static_cast<uint64_t>(bbox.y & 0xFFFF) << 32) | (static_cast<uint64_t>(bbox.w & 0xFFFF) << 16) | static_cast<uint64_t>(bbox.h & 0xFFFF);
+}
+
+int32_t main(int argc, char* argv[])
+{
+    printf("%6s %8s %10s %10s %10s %10s %12s %12s %8s %8s\n", "object", "det/frm", "p50[us]", "p90[us]", "p99[us]", "max[us]", "alloc/frm", "alloc/frm2", "id_sw", "track");
+    for (int32_t num : { 10, 100, 500, 1000, 2000 }) {
+        Scene scene(num, 1234);
+        Tracker tracker;
+        std::vector<BoundingBox> det_list;
+        std::vector<int32_t> gt_id_list;
+        std::unordered_map<uint64_t, int32_t> gt_id_for_bbox;
+        std::unordered_map<int32_t, int32_t> track_id_for_gt;
+        std::vector<double> time_list;
+        int64_t allocation_cnt_total = 0;
+        int64_t allocation_cnt_second_half = 0;
+        int64_t det_cnt_total = 0;
+        int32_t id_switch_cnt = 0;
+        int32_t track_id_max = -1;
+
+        for (int32_t frame = 0; frame < FRAME_NUM; frame++) {
+            scene.Step(det_list, gt_id_list);
+            det_cnt_total += det_list.size();
+
+            AllocationCounter::Start();
+            const auto& t0 = std::chrono::steady_clock::now();
+            tracker.Update(det_list);
+            const auto& t1 = std::chrono::steady_clock::now();
+            const int64_t allocation_cnt = AllocationCounter::Stop();
+            time_list.push_back(static_cast<std::chrono::duration<double>>(t1 - t0).count() * 1e6);
+            allocation_cnt_total += allocation_cnt;
+            if (frame >= FRAME_NUM / 2) allocation_cnt_second_half += allocation_cnt;
+
+            /* Identity switch: a GT object is associated with a track different from the previous one */
+            gt_id_for_bbox.clear();
+            for (size_t i = 0; i < det_list.size(); i++) gt_id_for_bbox[BboxKey(det_list[i])] = gt_id_list[i];
+            for (auto& track : tracker.GetTrackList()) {
+                track_id_max = (std::max)(track_id_max, track.GetId());
+                if (track.GetUndetectedCount() > 0) continue;
+                const auto& it = gt_id_for_bbox.find(BboxKey(track.GetLatestData().bbox_raw));
+                if (it == gt_id_for_bbox.end() || it->second < 0) continue;
+                auto it_track = track_id_for_gt.find(it->second);
+                if (it_track == track_id_for_gt.end()) {
+                    track_id_for_gt[it->second] = track.GetId();
+                } else if (it_track->second != track.GetId()) {
+                    id_switch_cnt++;
+                    it_track->second = track.GetId();
+                }
+            }
+        }
+
+        printf("%6d %8.1f %10.1f %10.1f %10.1f %10.1f %12.1f %12.1f %8d %8d\n", num, static_cast<double>(det_cnt_total) / FRAME_NUM,
+            Percentile(time_list, 0.5), Percentile(time_list, 0.9), Percentile(time_list, 0.99), Percentile(time_list, 1.0),
+            static_cast<double>(allocation_cnt_total) / FRAME_NUM, static_cast<double>(allocation_cnt_second_half) / (FRAME_NUM - FRAME_NUM / 2),
+            id_switch_cnt, track_id_max + 1);
+    }
+    printf("alloc/frm: operator new calls in Update per frame (all frames / second half, after buffers have grown)\n");
+    printf("id_sw: identity switches, track: number of tracks created\n");
+
+    return 0;
+}
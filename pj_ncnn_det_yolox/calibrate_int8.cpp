@@ -0,0 +1,371 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+/* Tool to create the int8 quantization table of ncnn from images in a local folder. The images are pre-processed in the same way as DetectionEngine */
+/* The int8 model is created from the table with ncnn2int8 in ncnn tools: */
+/*   calibrate_int8 yolox.param yolox.bin calibration_images/ yolox.table */
+/*   ncnn2int8 yolox.param yolox.bin yolox_int8.param yolox_int8.bin yolox.table */
+/* Weight scales are per output channel (abs max). Activation scales are decided by KL divergence, in the same way as ncnn2table */
+/*** Include ***/
+/* for general */
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <cmath>
+#include <cfloat>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+/* for OpenCV */
+#include <opencv2/opencv.hpp>
+
+/* for ncnn */
+#include "net.h"
+#include "layer.h"
+#include "datareader.h"
+#include "modelbin.h"
+
+/* for My modules */
+#include "common_helper_cv.h"
+#include "yolov5_focus.h"
+
+/*** Macro ***/
+/* Pre-process. The same as DetectionEngine */
+#define INPUT_WIDTH         640
+#define INPUT_HEIGHT        480
+#define IS_RGB              true
+#define NORM                (1.0f / 255.0f)
+
+#define IMAGE_NUM_MAX       1000
+#define NUM_THREADS         4
+#define HISTOGRAM_BIN_NUM   2048
+#define QUANTIZE_BIN_NUM    128     /* int8: [0, 127] for abs value */
+
+/*** Function ***/
+static ncnn::Layer* CreateYoloV5Focus(void* /*userdata*/)
+{
+    return new YoloV5Focus;
+}
+
+static bool IsQuantizeTarget(const std::string& type)
+{
+    return type == "Convolution" || type == "ConvolutionDepthWise" || type == "InnerProduct";
+}
+
+/* ModelBin which keeps every loaded Mat, so that weights of each layer can be read */
+class ModelBinRecorder : public ncnn::ModelBin {
+public:
+    ModelBinRecorder(const ncnn::DataReader& dr) : mb_(dr) {}
+    virtual ncnn::Mat load(int w, int type) const
+    {
+        ncnn::Mat m = mb_.load(w, type);
+        mat_list.push_back(m);
+        return m;
+    }
+    mutable std::vector<ncnn::Mat> mat_list;
+private:
+    ncnn::ModelBinFromDataReader mb_;
+};
+
+/* Read the number of channels to have each scale (num_output (id=0), or group (id=7) for depthwise) from text param */
+static bool ReadScaleNum(const std::string& param_filename, std::map<std::string, int32_t>& scale_num_map)
+{
+    std::ifstream ifs(param_filename);
+    if (ifs.fail()) {
+        printf("Failed to open %s\n", param_filename.c_str());
+        return false;
+    }
+    std::string line;
+    std::getline(ifs, line);    /* magic */
+    std::getline(ifs, line);    /* layer count, blob count */
+    while (std::getline(ifs, line)) {
+        std::istringstream iss(line);
+        std::string type, name, token;
+        int32_t bottom_num = 0, top_num = 0;
+        if (!(iss >> type >> name >> bottom_num >> top_num)) continue;
+        if (!IsQuantizeTarget(type)) continue;
+        for (int32_t i = 0; i < bottom_num + top_num; i++) iss >> token;
+        int32_t num_output = 0, group = 1;
+        while (iss >> token) {
+            if (token.compare(0, 2, "0=") == 0) num_output = std::atoi(token.c_str() + 2);
+            if (token.compare(0, 2, "7=") == 0) group = std::atoi(token.c_str() + 2);
+        }
+        scale_num_map[name] = (type == "ConvolutionDepthWise") ? group : num_output;
+    }
+    return true;
+}
+
+/* Weight scale for each output channel (group): 127 / abs max */
+static bool CalculateWeightScale(const std::string& param_filename, const std::string& model_filename, std::vector<std::pair<std::string, std::vector<float>>>& weight_scale_list)
+{
+    std::map<std::string, int32_t> scale_num_map;
+    if (!ReadScaleNum(param_filename, scale_num_map)) return false;
+
+    ncnn::Net net;
+    net.register_custom_layer("YoloV5Focus", CreateYoloV5Focus);
+    if (net.load_param(param_filename.c_str()) != 0) {
+        printf("Failed to load %s\n", param_filename.c_str());
+        return false;
+    }
+    FILE* fp = fopen(model_filename.c_str(), "rb");
+    if (!fp) {
+        printf("Failed to open %s\n", model_filename.c_str());
+        return false;
+    }
+    /* Load weights layer by layer to know which layer each Mat belongs to. The first Mat is weight_data for quantization target layers */
+    ncnn::DataReaderFromStdio dr(fp);
+    ModelBinRecorder mb(dr);
+    bool ret = true;
+    for (ncnn::Layer* layer : net.layers()) {
+        mb.mat_list.clear();
+        if (layer->load_model(mb) != 0) {
+            printf("Failed to load weights of %s\n", layer->name.c_str());
+            ret = false;
+            break;
+        }
+        if (!IsQuantizeTarget(layer->type) || mb.mat_list.empty()) continue;
+        const ncnn::Mat& weight = mb.mat_list[0];
+        const int32_t scale_num = scale_num_map[layer->name];
+        if (scale_num <= 0 || weight.w % scale_num != 0) {
+            printf("Unexpected weight size of %s\n", layer->name.c_str());
+            ret = false;
+            break;
+        }
+        const int32_t size_per_scale = weight.w / scale_num;
+        const float* data = weight;
+        std::vector<float> scale_list(scale_num);
+        for (int32_t i = 0; i < scale_num; i++) {
+            float abs_max = 0;
+            for (int32_t j = 0; j < size_per_scale; j++) abs_max = (std::max)(abs_max, std::abs(data[i * size_per_scale + j]));
+            scale_list[i] = (abs_max == 0) ? 1.0f : 127.0f / abs_max;
+        }
+        weight_scale_list.push_back(std::make_pair(layer->name, scale_list));
+    }
+    fclose(fp);
+    return ret;
+}
+
+static void Normalize(std::vector<float>& distribution)
+{
+    float sum = 0;
+    for (const auto& v : distribution) sum += v;
+    if (sum == 0) return;
+    for (auto& v : distribution) v /= sum;
+}
+
+static float CalculateKlDivergence(const std::vector<float>& p, const std::vector<float>& q)
+{
+    float kl = 0;
+    for (size_t i = 0; i < p.size(); i++) {
+        if (p[i] == 0) continue;
+        kl += p[i] * std::log(p[i] / q[i]);
+    }
+    return kl;
+}
+
+/* Find the threshold whose quantized distribution (QUANTIZE_BIN_NUM bins) is the closest to the original. Returns the index of the bin */
+static int32_t FindKlThreshold(const std::vector<float>& histogram)
+{
+    static constexpr float kEps = 0.0001f;
+    int32_t threshold_best = HISTOGRAM_BIN_NUM - 1;
+    float kl_min = FLT_MAX;
+    for (int32_t threshold = QUANTIZE_BIN_NUM; threshold < HISTOGRAM_BIN_NUM; threshold++) {
+        /* Reference distribution: values beyond the threshold are clipped into the last bin */
+        std::vector<float> clip_distribution(threshold, kEps);
+        for (int32_t i = 0; i < threshold; i++) clip_distribution[i] += histogram[i];
+        for (int32_t i = threshold; i < HISTOGRAM_BIN_NUM; i++) clip_distribution[threshold - 1] += histogram[i];
+
+        /* Quantize into QUANTIZE_BIN_NUM bins, and expand back to threshold bins (only to non-zero bins) */
+        const float bin_num_per_quantize = static_cast<float>(threshold) / QUANTIZE_BIN_NUM;
+        std::vector<float> expand_distribution(threshold, kEps);
+        for (int32_t q = 0; q < QUANTIZE_BIN_NUM; q++) {
+            const float start = q * bin_num_per_quantize;
+            const float end = start + bin_num_per_quantize;
+            const int32_t left_upper = static_cast<int32_t>(std::ceil(start));
+            const int32_t right_lower = static_cast<int32_t>(std::floor(end));
+            const float left_scale = left_upper - start;
+            const float right_scale = end - right_lower;
+            float sum = 0;
+            float count = 0;
+            if (left_scale > 0) {
+                sum += left_scale * histogram[left_upper - 1];
+                if (histogram[left_upper - 1] != 0) count += left_scale;
+            }
+            if (right_scale > 0) {
+                sum += right_scale * histogram[right_lower];
+                if (histogram[right_lower] != 0) count += right_scale;
+            }
+            for (int32_t i = left_upper; i < right_lower; i++) {
+                sum += histogram[i];
+                if (histogram[i] != 0) count += 1;
+            }
+            if (count == 0) continue;
+            const float value = sum / count;
+            if (left_scale > 0 && histogram[left_upper - 1] != 0) expand_distribution[left_upper - 1] += value * left_scale;
+            if (right_scale > 0 && histogram[right_lower] != 0) expand_distribution[right_lower] += value * right_scale;
+            for (int32_t i = left_upper; i < right_lower; i++) {
+                if (histogram[i] != 0) expand_distribution[i] += value;
+            }
+        }
+
+        Normalize(clip_distribution);
+        Normalize(expand_distribution);
+        const float kl = CalculateKlDivergence(clip_distribution, expand_distribution);
+        if (kl < kl_min) {
+            kl_min = kl;
+            threshold_best = threshold;
+        }
+    }
+    return threshold_best;
+}
+
+static void PreProcess(const cv::Mat& original_mat, ncnn::Mat& in)
+{
+    int32_t crop_x = 0;
+    int32_t crop_y = 0;
+    int32_t crop_w = original_mat.cols;
+    int32_t crop_h = original_mat.rows;
+    cv::Mat img_src = cv::Mat::zeros(INPUT_HEIGHT, INPUT_WIDTH, CV_8UC3);
+    CommonHelper::CropResizeCvt(original_mat, img_src, crop_x, crop_y, crop_w, crop_h, IS_RGB, CommonHelper::kCropTypeExpand);
+    in = ncnn::Mat::from_pixels(img_src.data, ncnn::Mat::PIXEL_RGB, img_src.cols, img_src.rows);
+    const float norm[3] = { NORM, NORM, NORM };
+    in.substract_mean_normalize(0, norm);
+}
+
+/* Activation scale for the input blob of each quantization target layer: 127 / threshold by KL divergence */
+static bool CalculateActivationScale(const std::string& param_filename, const std::string& model_filename, const std::vector<std::string>& image_filename_list, std::vector<std::pair<std::string, float>>& activation_scale_list)
+{
+    ncnn::Net net;
+    net.opt.num_threads = NUM_THREADS;
+    net.opt.use_fp16_packed = false;
+    net.opt.use_fp16_storage = false;
+    net.opt.use_fp16_arithmetic = false;
+    net.opt.use_bf16_storage = false;
+    net.register_custom_layer("YoloV5Focus", CreateYoloV5Focus);
+    if (net.load_param(param_filename.c_str()) != 0 || net.load_model(model_filename.c_str()) != 0) {
+        printf("Failed to load %s\n", param_filename.c_str());
+        return false;
+    }
+
+    int32_t input_blob = -1;
+    std::vector<const ncnn::Layer*> target_list;
+    for (const ncnn::Layer* layer : net.layers()) {
+        if (layer->type == "Input") input_blob = layer->tops[0];
+        if (IsQuantizeTarget(layer->type)) target_list.push_back(layer);
+    }
+    if (input_blob < 0 || target_list.empty()) {
+        printf("Input layer or quantization target is not found\n");
+        return false;
+    }
+
+    /* 1st pass: abs max of each blob. 2nd pass: histogram of abs value in [0, abs max] */
+    std::vector<float> abs_max_list(target_list.size(), 0);
+    std::vector<std::vector<float>> histogram_list(target_list.size(), std::vector<float>(HISTOGRAM_BIN_NUM, 0));
+    for (int32_t pass = 0; pass < 2; pass++) {
+        for (size_t i = 0; i < image_filename_list.size(); i++) {
+            cv::Mat original_mat = cv::imread(image_filename_list[i]);
+            if (original_mat.empty()) continue;
+            ncnn::Mat in;
+            PreProcess(original_mat, in);
+            ncnn::Extractor ex = net.create_extractor();
+            ex.input(input_blob, in);
+            for (size_t t = 0; t < target_list.size(); t++) {
+                ncnn::Mat out;
+                ex.extract(target_list[t]->bottoms[0], out);
+                for (int32_t c = 0; c < out.c; c++) {
+                    const float* data = out.channel(c);
+                    const int32_t size = out.w * out.h;
+                    if (pass == 0) {
+                        for (int32_t k = 0; k < size; k++) abs_max_list[t] = (std::max)(abs_max_list[t], std::abs(data[k]));
+                    } else {
+                        if (abs_max_list[t] == 0) break;
+                        const float bin_width = abs_max_list[t] / HISTOGRAM_BIN_NUM;
+                        for (int32_t k = 0; k < size; k++) {
+                            if (data[k] == 0) continue;
+                            const int32_t index = (std::min)(static_cast<int32_t>(std::abs(data[k]) / bin_width), HISTOGRAM_BIN_NUM - 1);
+                            histogram_list[t][index] += 1;
+                        }
+                    }
+                }
+            }
+            printf("\rpass %d/2: %zu/%zu", pass + 1, i + 1, image_filename_list.size());
+            fflush(stdout);
+        }
+        printf("\n");
+    }
+
+    for (size_t t = 0; t < target_list.size(); t++) {
+        float scale = 1.0f;
+        if (abs_max_list[t] > 0) {
+            Normalize(histogram_list[t]);
+            const int32_t threshold = FindKlThreshold(histogram_list[t]);
+            scale = 127.0f / ((threshold + 0.5f) * abs_max_list[t] / HISTOGRAM_BIN_NUM);
+        }
+        activation_scale_list.push_back(std::make_pair(target_list[t]->name, scale));
+    }
+    return true;
+}
+
+int32_t main(int argc, char* argv[])
+{
+    if (argc < 5) {
+        printf("usage: %s <param> <bin> <image dir> <output table>\n", argv[0]);
+        return -1;
+    }
+    const std::string param_filename = argv[1];
+    const std::string model_filename = argv[2];
+    const std::string image_dir = argv[3];
+    const std::string table_filename = argv[4];
+
+    std::vector<std::string> image_filename_list;
+    for (const char* ext : { "jpg", "jpeg", "png", "bmp" }) {
+        std::vector<cv::String> filename_list;
+        cv::glob(image_dir + "/*." + ext, filename_list, false);
+        image_filename_list.insert(image_filename_list.end(), filename_list.begin(), filename_list.end());
+    }
+    std::sort(image_filename_list.begin(), image_filename_list.end());
+    if (image_filename_list.size() > IMAGE_NUM_MAX) image_filename_list.resize(IMAGE_NUM_MAX);
+    if (image_filename_list.empty()) {
+        printf("No image found in %s\n", image_dir.c_str());
+        return -1;
+    }
+    printf("Calibration images: %zu\n", image_filename_list.size());
+
+    std::vector<std::pair<std::string, std::vector<float>>> weight_scale_list;
+    if (!CalculateWeightScale(param_filename, model_filename, weight_scale_list)) return -1;
+    std::vector<std::pair<std::string, float>> activation_scale_list;
+    if (!CalculateActivationScale(param_filename, model_filename, image_filename_list, activation_scale_list)) return -1;
+
+    /* Table format of ncnn2int8: "<layer>_param_0 <weight scales...>" for weights, and "<layer> <scale>" for the input blob */
+    FILE* fp = fopen(table_filename.c_str(), "w");
+    if (!fp) {
+        printf("Failed to create %s\n", table_filename.c_str());
+        return -1;
+    }
+    for (const auto& weight_scale : weight_scale_list) {
+        fprintf(fp, "%s_param_0", weight_scale.first.c_str());
+        for (const auto& scale : weight_scale.second) fprintf(fp, " %f", scale);
+        fprintf(fp, "\n");
+    }
+    for (const auto& activation_scale : activation_scale_list) {
+        fprintf(fp, "%s %f\n", activation_scale.first.c_str(), activation_scale.second);
+    }
+    fclose(fp);
+    printf("Created %s (%zu layers)\n", table_filename.c_str(), activation_scale_list.size());
+    return 0;
+}
@@ -0,0 +1,55 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+/* Tool to pack model files into one bundle file (see model_bundle.h) */
+/* e.g. create_model_bundle yolox.bundle meta=yolox_bundle_meta.txt label=label_coco_80.txt  (for DetectionEngine) */
+/*      create_model_bundle yolox_full.bundle param=yolox.param bin=yolox.bin  (for benchmark_startup) */
+/*** Include ***/
+/* for general */
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <utility>
+
+/* for My modules */
+#include "model_bundle.h"
+
+/*** Function ***/
+int32_t main(int argc, char* argv[])
+{
+    if (argc < 3) {
+        printf("usage: %s <output bundle> <section>=<file> ...\n", argv[0]);
+        printf("  section: meta, label, param, bin\n");
+        return -1;
+    }
+
+    std::vector<std::pair<std::string, std::string>> section_file_list;
+    for (int32_t i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        size_t pos = arg.find('=');
+        if (pos == std::string::npos) {
+            printf("Invalid argument: %s\n", arg.c_str());
+            return -1;
+        }
+        section_file_list.push_back(std::make_pair(arg.substr(0, pos), arg.substr(pos + 1)));
+    }
+
+    if (ModelBundle::Create(argv[1], section_file_list) != ModelBundle::kRetOk) {
+        return -1;
+    }
+    printf("Created %s\n", argv[1]);
+    return 0;
+}
@@ -33,6 +33,8 @@ limitations under the License.
 #include "common_helper_cv.h"
 #include "inference_helper.h"
 #include "inference_helper_tensorrt.h"      // to call SetDlaCore
+#include "model_bundle.h"
+#include "yolov5_focus.h"
 #include "detection_engine.h"
 
 /*** Macro ***/
@@ -43,6 +45,7 @@ limitations under the License.
 /* Model parameters */
 /* https://github.com/Megvii-BaseDetection/YOLOX/releases/download/0.1.1rc0/yolox_s_ncnn.tar.gz */
 #define MODEL_NAME  "yolox.param"
+#define MODEL_NAME_INT8 "yolox_int8.param"     /* created with calibrate_int8 and ncnn2int8. Input and output are still fp32 */
 #define TENSORTYPE  TensorInfo::kTensorTypeFp32
 #define INPUT_NAME  "images"
 #define INPUT_DIMS  { 1, 3, 480, 640 }
@@ -56,63 +59,25 @@ static constexpr int32_t kNumberOfClass = 80;
 static constexpr int32_t kElementNumOfAnchor = kNumberOfClass + 5;    // x, y, w, h, bbox confidence, [class confidence]
 
 #define LABEL_NAME   "label_coco_80.txt"
+#define BUNDLE_NAME  "yolox.bundle"     /* model information in the bundle is used instead of the values above if exists */
 
 /*** Custome layers for ncnn ***/
-/* Reference: https://github.com/Tencent/ncnn/blob/master/examples/yolox.cpp */
-#include "net.h"
-class YoloV5Focus : public ncnn::Layer
-{
-public:
-    YoloV5Focus()
-    {
-        one_blob_only = true;
-    }
-
-    virtual int forward(const ncnn::Mat& bottom_blob, ncnn::Mat& top_blob, const ncnn::Option& opt) const
-    {
-        int w = bottom_blob.w;
-        int h = bottom_blob.h;
-        int channels = bottom_blob.c;
-
-        int outw = w / 2;
-        int outh = h / 2;
-        int outc = channels * 4;
-
-        top_blob.create(outw, outh, outc, 4u, 1, opt.blob_allocator);
-        if (top_blob.empty())
-            return -100;
-
-#pragma omp parallel for num_threads(opt.num_threads)
-        for (int p = 0; p < outc; p++)
-        {
-            const float* ptr = bottom_blob.channel(p % channels).row((p / channels) % 2) + ((p / channels) / 2);
-            float* outptr = top_blob.channel(p);
-
-            for (int i = 0; i < outh; i++)
-            {
-                for (int j = 0; j < outw; j++)
-                {
-                    *outptr = *ptr;
-
-                    outptr += 1;
-                    ptr += 2;
-                }
-
-                ptr += w;
-            }
-        }
-
-        return 0;
-    }
-};
 DEFINE_LAYER_CREATOR(YoloV5Focus)
 
 /*** Function ***/
-int32_t DetectionEngine::Initialize(const std::string& work_dir, const int32_t num_threads)
+int32_t DetectionEngine::Initialize(const std::string& work_dir, const int32_t num_threads, const int32_t num_warmup)
 {
     /* Set model information */
-    std::string model_filename = work_dir + "/model/" + MODEL_NAME;
+    std::string model_filename = work_dir + "/model/" + (is_int8_ ? MODEL_NAME_INT8 : MODEL_NAME);
     std::string labelFilename = work_dir + "/model/" + LABEL_NAME;
+    ModelBundle bundle;
+    const std::string bundle_filename = work_dir + "/model/" + BUNDLE_NAME;
+    if (std::ifstream(bundle_filename).good()) {
+        if (bundle.Open(bundle_filename) != ModelBundle::kRetOk) {
+            return kRetErr;
+        }
+        model_filename = work_dir + "/model/" + (is_int8_ ? bundle.GetMeta("model_file_int8", MODEL_NAME_INT8) : bundle.GetMeta("model_file", MODEL_NAME));
+    }
 
     /* Set input tensor info */
     input_tensor_info_list_.clear();
@@ -125,11 +90,22 @@ int32_t DetectionEngine::Initialize(const std::string& work_dir, const int32_t n
     input_tensor_info.normalize.norm[0] = 1.0f / 255.0f;
     input_tensor_info.normalize.norm[1] = 1.0f / 255.0f;
     input_tensor_info.normalize.norm[2] = 1.0f / 255.0f;
+    is_rgb_ = IS_RGB;
+    std::vector<std::string> output_name_list = { OUTPUT_NAME };
+    if (bundle.IsOpened() && bundle.GetModelInfo(input_tensor_info.name, input_tensor_info.tensor_dims, input_tensor_info.normalize.mean, input_tensor_info.normalize.norm, is_rgb_, output_name_list) != ModelBundle::kRetOk) {
+        return kRetErr;
+    }
+    if (input_width_ > 0 && input_height_ > 0) {
+        input_tensor_info.tensor_dims[2] = input_height_;
+        input_tensor_info.tensor_dims[3] = input_width_;
+    }
     input_tensor_info_list_.push_back(input_tensor_info);
 
     /* Set output tensor info */
     output_tensor_info_list_.clear();
-    output_tensor_info_list_.push_back(OutputTensorInfo(OUTPUT_NAME, TENSORTYPE));
+    for (const auto& output_name : output_name_list) {
+        output_tensor_info_list_.push_back(OutputTensorInfo(output_name, TENSORTYPE));
+    }
 
     /* Create and Initialize Inference Helper */
     inference_helper_.reset(InferenceHelper::Create(InferenceHelper::kNcnn));
@@ -157,13 +133,60 @@ int32_t DetectionEngine::Initialize(const std::string& work_dir, const int32_t n
     }
 
     /* read label */
-    if (ReadLabel(labelFilename, label_list_) != kRetOk) {
+    if (bundle.IsOpened()) {
+        bundle.GetLabelList(label_list_);
+    } else if (ReadLabel(labelFilename, label_list_) != kRetOk) {
         return kRetErr;
     }
 
+    if (Warmup(num_warmup) != kRetOk) {
+        PRINT_E("Warm-up failed\n");
+        return kRetErr;
+    }
+
+    return kRetOk;
+}
+
+int32_t DetectionEngine::Warmup(int32_t num_warmup)
+{
+    InputTensorInfo& input_tensor_info = input_tensor_info_list_[0];
+    cv::Mat img_src = cv::Mat::zeros(input_tensor_info.GetHeight(), input_tensor_info.GetWidth(), CV_8UC3);
+    Result result;
+    if (!CommonHelper::Warmup(num_warmup, [&]() { return Process(img_src, result) == kRetOk; })) {
+        return kRetErr;
+    }
     return kRetOk;
 }
 
+int32_t DetectionEngine::SetInputSize(int32_t width, int32_t height)
+{
+    /* The model is fully convolutional. Grid size for each scale is derived from the input size in Process */
+    for (const auto& grid_scale : kGridScaleList) {
+        if (width <= 0 || height <= 0 || width % grid_scale != 0 || height % grid_scale != 0) {
+            PRINT_E("Invalid input size (%d x %d). It must be multiples of %d\n", width, height, grid_scale);
+            return kRetErr;
+        }
+    }
+    input_width_ = width;
+    input_height_ = height;
+    if (!input_tensor_info_list_.empty()) {
+        input_tensor_info_list_[0].tensor_dims[2] = height;
+        input_tensor_info_list_[0].tensor_dims[3] = width;
+    }
+    return kRetOk;
+}
+
+void DetectionEngine::GetInputSize(int32_t& width, int32_t& height) const
+{
+    if (!input_tensor_info_list_.empty()) {
+        width = input_tensor_info_list_[0].GetWidth();
+        height = input_tensor_info_list_[0].GetHeight();
+    } else {
+        width = input_width_;
+        height = input_height_;
+    }
+}
+
 int32_t DetectionEngine::Finalize()
 {
     if (!inference_helper_) {
@@ -200,7 +223,7 @@ void DetectionEngine::GetBoundingBox(const float* data, float scale_x, float  sc
                         int32_t h = static_cast<int32_t>(std::exp(data[index + 3]) * scale_y);
                         int32_t x = cx - w / 2;
                         int32_t y = cy - h / 2;
-                        bbox_list.push_back(BoundingBox(class_id, "", confidence, x, y, w, h));
+                        bbox_list.push_back(BoundingBox(class_id, confidence, x, y, w, h));
                     }
                 }
                 index += kElementNumOfAnchor;
@@ -210,6 +233,16 @@ void DetectionEngine::GetBoundingBox(const float* data, float scale_x, float  sc
 }
 
 
+/* NMS is O(N^2), so too many candidates (e.g. with low threshold) are cut by score */
+void DetectionEngine::LimitCandidate(std::vector<BoundingBox>& bbox_list)
+{
+    if (candidate_max_ <= 0 || static_cast<int32_t>(bbox_list.size()) <= candidate_max_) return;
+    std::nth_element(bbox_list.begin(), bbox_list.begin() + candidate_max_, bbox_list.end(),
+        [](const BoundingBox& lhs, const BoundingBox& rhs) { return lhs.score > rhs.score; });
+    bbox_list.erase(bbox_list.begin() + candidate_max_, bbox_list.end());
+}
+
+
 int32_t DetectionEngine::Process(const cv::Mat& original_mat, Result& result)
 {
     if (!inference_helper_) {
@@ -227,20 +260,9 @@ int32_t DetectionEngine::Process(const cv::Mat& original_mat, Result& result)
     cv::Mat img_src = cv::Mat::zeros(input_tensor_info.GetHeight(), input_tensor_info.GetWidth(), CV_8UC3);
     //CommonHelper::CropResizeCvt(original_mat, img_src, crop_x, crop_y, crop_w, crop_h, IS_RGB, CommonHelper::kCropTypeStretch);
     //CommonHelper::CropResizeCvt(original_mat, img_src, crop_x, crop_y, crop_w, crop_h, IS_RGB, CommonHelper::kCropTypeCut);
-    CommonHelper::CropResizeCvt(original_mat, img_src, crop_x, crop_y, crop_w, crop_h, IS_RGB, CommonHelper::kCropTypeExpand);
+    CommonHelper::CropResizeCvt(original_mat, img_src, crop_x, crop_y, crop_w, crop_h, is_rgb_, CommonHelper::kCropTypeExpand);
 
-    input_tensor_info.data = img_src.data;
-    input_tensor_info.data_type = InputTensorInfo::kDataTypeImage;
-    input_tensor_info.image_info.width = img_src.cols;
-    input_tensor_info.image_info.height = img_src.rows;
-    input_tensor_info.image_info.channel = img_src.channels();
-    input_tensor_info.image_info.crop_x = 0;
-    input_tensor_info.image_info.crop_y = 0;
-    input_tensor_info.image_info.crop_width = img_src.cols;
-    input_tensor_info.image_info.crop_height = img_src.rows;
-    input_tensor_info.image_info.is_bgr = false;
-    input_tensor_info.image_info.swap_color = false;
-    if (inference_helper_->PreProcess(input_tensor_info_list_) != InferenceHelper::kRetOk) {
+    if (PreProcessImage(img_src) != kRetOk) {
         return kRetErr;
     }
     const auto& t_pre_process1 = std::chrono::steady_clock::now();
@@ -265,13 +287,13 @@ int32_t DetectionEngine::Process(const cv::Mat& original_mat, Result& result)
         GetBoundingBox(output_data, scale_x, scale_y, grid_w, grid_h, bbox_list);
         output_data += grid_w * grid_h * kGridChannel * kElementNumOfAnchor;
     }
+    LimitCandidate(bbox_list);
 
 
     /* Adjust bounding box */
     for (auto& bbox : bbox_list) {
         bbox.x += crop_x;  
         bbox.y += crop_y;
-        bbox.label = label_list_[bbox.class_id];
     }
 
     /* NMS */
@@ -294,6 +316,109 @@ int32_t DetectionEngine::Process(const cv::Mat& original_mat, Result& result)
 }
 
 
+int32_t DetectionEngine::PreProcessImage(const cv::Mat& img_src)
+{
+    InputTensorInfo& input_tensor_info = input_tensor_info_list_[0];
+    input_tensor_info.data = img_src.data;
+    input_tensor_info.data_type = InputTensorInfo::kDataTypeImage;
+    input_tensor_info.image_info.width = img_src.cols;
+    input_tensor_info.image_info.height = img_src.rows;
+    input_tensor_info.image_info.channel = img_src.channels();
+    input_tensor_info.image_info.crop_x = 0;
+    input_tensor_info.image_info.crop_y = 0;
+    input_tensor_info.image_info.crop_width = img_src.cols;
+    input_tensor_info.image_info.crop_height = img_src.rows;
+    input_tensor_info.image_info.is_bgr = false;
+    input_tensor_info.image_info.swap_color = false;
+    if (inference_helper_->PreProcess(input_tensor_info_list_) != InferenceHelper::kRetOk) {
+        return kRetErr;
+    }
+    return kRetOk;
+}
+
+
+int32_t DetectionEngine::ProcessMosaic(const cv::Mat& original_mat, const std::vector<cv::Rect>& roi_list, Result& result)
+{
+    if (roi_list.empty() || static_cast<int32_t>(roi_list.size()) > kMosaicTileMax) {
+        return Process(original_mat, result);
+    }
+    if (!inference_helper_) {
+        PRINT_E("Inference helper is not created\n");
+        return kRetErr;
+    }
+    /*** PreProcess ***/
+    const auto& t_pre_process0 = std::chrono::steady_clock::now();
+    InputTensorInfo& input_tensor_info = input_tensor_info_list_[0];
+    /* Each ROI is letterboxed into its own tile, so small objects keep (close to) native resolution */
+    /* The image is reused across frames. It's cleared every frame because tiles don't write the letterbox margins */
+    mosaic_image_.create(input_tensor_info.GetHeight(), input_tensor_info.GetWidth(), CV_8UC3);
+    mosaic_image_.setTo(cv::Scalar(0, 0, 0));
+    CommonHelper::CropResizeCvtMosaic(original_mat, mosaic_image_, roi_list, mosaic_tile_list_, is_rgb_);
+    if (PreProcessImage(mosaic_image_) != kRetOk) {
+        return kRetErr;
+    }
+    const auto& t_pre_process1 = std::chrono::steady_clock::now();
+
+    /*** Inference ***/
+    const auto& t_inference0 = std::chrono::steady_clock::now();
+    if (inference_helper_->Process(output_tensor_info_list_) != InferenceHelper::kRetOk) {
+        return kRetErr;
+    }
+    const auto& t_inference1 = std::chrono::steady_clock::now();
+
+    /*** PostProcess ***/
+    const auto& t_post_process0 = std::chrono::steady_clock::now();
+    /* Get boundig box in the mosaic image coordinate */
+    bbox_mosaic_list_.clear();
+    float* output_data = output_tensor_info_list_[0].GetDataAsFloat();
+    for (const auto& grid_scale : kGridScaleList) {
+        int32_t grid_w = input_tensor_info.GetWidth() / grid_scale;
+        int32_t grid_h = input_tensor_info.GetHeight() / grid_scale;
+        GetBoundingBox(output_data, static_cast<float>(grid_scale), static_cast<float>(grid_scale), grid_w, grid_h, bbox_mosaic_list_);
+        output_data += grid_w * grid_h * kGridChannel * kElementNumOfAnchor;
+    }
+    LimitCandidate(bbox_mosaic_list_);
+
+    /* Map bounding box to the original image via the tile which contains its center. A box over tiles is clipped to the tile */
+    bbox_frame_list_.clear();
+    for (const auto& bbox : bbox_mosaic_list_) {
+        int32_t index = CommonHelper::FindMosaicTile(mosaic_tile_list_, bbox.x + bbox.w / 2, bbox.y + bbox.h / 2);
+        if (index < 0) continue;
+        const cv::Rect& tile = mosaic_tile_list_[index].tile;
+        const cv::Rect& crop = mosaic_tile_list_[index].crop;
+        int32_t x0 = (std::max)(bbox.x, tile.x) - tile.x;
+        int32_t y0 = (std::max)(bbox.y, tile.y) - tile.y;
+        int32_t x1 = (std::min)(bbox.x + bbox.w, tile.x + tile.width) - tile.x;
+        int32_t y1 = (std::min)(bbox.y + bbox.h, tile.y + tile.height) - tile.y;
+        BoundingBox bbox_frame = bbox;
+        bbox_frame.x = crop.x + x0 * crop.width / tile.width;
+        bbox_frame.y = crop.y + y0 * crop.height / tile.height;
+        bbox_frame.w = (x1 - x0) * crop.width / tile.width;
+        bbox_frame.h = (y1 - y0) * crop.height / tile.height;
+        bbox_frame_list_.push_back(bbox_frame);
+    }
+
+    /* NMS (the same object may be detected in overlapped ROIs). The result is written into the caller's list to reuse its capacity */
+    result.bbox_list.clear();
+    BoundingBoxUtils::Nms(bbox_frame_list_, result.bbox_list, threshold_nms_iou_);
+
+    const auto& t_post_process1 = std::chrono::steady_clock::now();
+
+    /* Return the results. crop is the area which covers all ROIs */
+    cv::Rect crop_all = mosaic_tile_list_[0].crop;
+    for (const auto& mosaic_tile : mosaic_tile_list_) crop_all |= mosaic_tile.crop;
+    crop_all &= cv::Rect(0, 0, original_mat.cols, original_mat.rows);
+    result.crop.x = crop_all.x;
+    result.crop.y = crop_all.y;
+    result.crop.w = crop_all.width;
+    result.crop.h = crop_all.height;
+    result.time_pre_process = static_cast<std::chrono::duration<double>>(t_pre_process1 - t_pre_process0).count() * 1000.0;
+    result.time_inference = static_cast<std::chrono::duration<double>>(t_inference1 - t_inference0).count() * 1000.0;
+    result.time_post_process = static_cast<std::chrono::duration<double>>(t_post_process1 - t_post_process0).count() * 1000.0;
+
+    return kRetOk;
+}
+
 int32_t DetectionEngine::ReadLabel(const std::string& filename, std::vector<std::string>& label_list)
 {
     std::ifstream ifs(filename);
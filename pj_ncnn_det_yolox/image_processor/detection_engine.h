@@ -29,6 +29,7 @@ limitations under the License.
 /* for My modules */
 #include "inference_helper.h"
 #include "bounding_box.h"
+#include "common_helper_cv.h"
 
 
 class DetectionEngine {
@@ -54,31 +55,66 @@ public:
         {}
     } Result;
 
+public:
+    static constexpr int32_t kMosaicTileMax = 9;  /* 3 x 3. Each tile gets too small for more ROIs */
+
 public:
     DetectionEngine() {
         threshold_box_confidence_ = 0.4f;
         threshold_class_confidence_ = 0.2f;
         threshold_nms_iou_ = 0.5f;
+        is_rgb_ = true;
+        is_int8_ = false;
+        input_width_ = 0;
+        input_height_ = 0;
+        candidate_max_ = 0;
     }
     ~DetectionEngine() {}
-    int32_t Initialize(const std::string& work_dir, const int32_t num_threads);
+    int32_t Initialize(const std::string& work_dir, const int32_t num_threads, const int32_t num_warmup = 0);
     int32_t Finalize(void);
     int32_t Process(const cv::Mat& original_mat, Result& result);
+    /* Run detection only on roi_list (e.g. areas around tracks) packed into one input image. Falls back to Process when there are too many ROIs */
+    int32_t ProcessMosaic(const cv::Mat& original_mat, const std::vector<cv::Rect>& roi_list, Result& result);
+    /* Change the model input size. Width and height must be multiples of the max stride. Can be called before Initialize or between frames */
+    int32_t SetInputSize(int32_t width, int32_t height);
+    void GetInputSize(int32_t& width, int32_t& height) const;
+    /* Use the int8 quantized model instead of fp32. Call before Initialize */
+    void SetInt8(bool is_int8) { is_int8_ = is_int8; }
+    /* Keep only candidate_max boxes with the highest scores before NMS (0: no limit) */
+    void SetCandidateMax(int32_t candidate_max) { candidate_max_ = candidate_max; }
     void SetThreshold(float threshold_box_confidence, float threshold_class_confidence, float threshold_nms_iou) {
         threshold_box_confidence_ = threshold_box_confidence;
         threshold_class_confidence_ = threshold_class_confidence;
         threshold_nms_iou_ = threshold_nms_iou;
     }
+    const char* GetLabel(int32_t class_id) const {
+        if (class_id < 0 || class_id >= static_cast<int32_t>(label_list_.size())) return "";
+        return label_list_[class_id].c_str();
+    }
 
 private:
+    int32_t Warmup(int32_t num_warmup);
     int32_t ReadLabel(const std::string& filename, std::vector<std::string>& label_list);
     void GetBoundingBox(const float* data, float scale_x, float  scale_y, int32_t grid_w, int32_t grid_h, std::vector<BoundingBox>& bbox_list);
+    void LimitCandidate(std::vector<BoundingBox>& bbox_list);
+    int32_t PreProcessImage(const cv::Mat& img_src);
 
 private:
     std::unique_ptr<InferenceHelper> inference_helper_;
     std::vector<InputTensorInfo> input_tensor_info_list_;
     std::vector<OutputTensorInfo> output_tensor_info_list_;
     std::vector<std::string> label_list_;
+    bool is_rgb_;
+    bool is_int8_;
+    int32_t input_width_;   /* 0: use the size of the model information */
+    int32_t input_height_;
+    int32_t candidate_max_;
+
+    /* work buffers reused for each frame of ProcessMosaic to avoid allocation */
+    std::vector<CommonHelper::MosaicTile> mosaic_tile_list_;
+    cv::Mat mosaic_image_;
+    std::vector<BoundingBox> bbox_mosaic_list_;
+    std::vector<BoundingBox> bbox_frame_list_;
 
     float threshold_box_confidence_;
     float threshold_class_confidence_;
@@ -32,9 +32,11 @@ limitations under the License.
 /* for My modules */
 #include "common_helper.h"
 #include "common_helper_cv.h"
+#include "thread_placement.h"
 #include "bounding_box.h"
 #include "detection_engine.h"
 #include "tracker.h"
+#include "quality_controller.h"
 #include "image_processor.h"
 
 /*** Macro ***/
@@ -42,9 +44,23 @@ limitations under the License.
 #define PRINT(...)   COMMON_HELPER_PRINT(TAG, __VA_ARGS__)
 #define PRINT_E(...) COMMON_HELPER_PRINT_E(TAG, __VA_ARGS__)
 
+#define MOTION_RATIO_PER_INTERVAL   0.3f    /* Allowed movement (ratio to the box size) b/w detections in adaptive interval */
+#define DETECTED_COUNT_STABLE       3       /* Track detected less than this is unstable, and detection runs every frame */
+#define ROI_MARGIN_RATIO            0.5f    /* ROI for refinement = track's bbox + margin (ratio to the box size) on each side */
+
 /*** Global variable ***/
 std::unique_ptr<DetectionEngine> s_engine;
+ThreadPlacement s_thread_placement;
 Tracker s_tracker;
+int32_t s_detection_interval_max = 1;
+bool s_is_detection_interval_adaptive = false;
+int32_t s_detection_interval = 1;
+int32_t s_frame_cnt_from_detection = 0;
+bool s_is_roi_refinement = false;
+std::vector<cv::Rect> s_roi_list;
+std::vector<BoundingBox> s_bbox_pred_list;
+QualityController s_quality_controller;
+QualityController::OperatingPoint s_best_point;     /* operating point at the level 0 */
 
 /*** Function ***/
 static void DrawFps(cv::Mat& mat, double time_inference, cv::Point pos, double font_scale, int32_t thickness, cv::Scalar color_front, cv::Scalar color_back, bool is_text_on_rect = true)
@@ -71,6 +87,56 @@ static cv::Scalar GetColorForId(int32_t id)
     return color_list[id % kMaxNum];
 }
 
+/* Decide the next detection interval from the current tracks. Detect every frame when tracks are unstable, and detect more often when objects move fast */
+static int32_t DecideDetectionInterval(Tracker::TrackList& track_list)
+{
+    if (!s_is_detection_interval_adaptive) return s_detection_interval_max;
+
+    float motion_ratio_max = 0;
+    for (auto& track : track_list) {
+        if (track.GetDetectedCount() < DETECTED_COUNT_STABLE || track.GetUndetectedCount() > 0) return 1;
+        const auto& track_history = track.GetDataHistory();
+        if (track_history.size() < 2) continue;
+        const auto& bbox0 = track_history[track_history.size() - 2].bbox;
+        const auto& bbox1 = track_history[track_history.size() - 1].bbox;
+        float motion = static_cast<float>((std::max)(std::abs((bbox1.x + bbox1.w / 2) - (bbox0.x + bbox0.w / 2)), std::abs((bbox1.y + bbox1.h / 2) - (bbox0.y + bbox0.h / 2))));
+        float size = static_cast<float>((std::max)((std::min)(bbox1.w, bbox1.h), 1));
+        motion_ratio_max = (std::max)(motion_ratio_max, motion / size);
+    }
+    if (motion_ratio_max * s_detection_interval_max <= MOTION_RATIO_PER_INTERVAL) return s_detection_interval_max;
+    return (std::min)((std::max)(static_cast<int32_t>(MOTION_RATIO_PER_INTERVAL / motion_ratio_max), 1), s_detection_interval_max);
+}
+
+/* Create ROIs around the predicted position of tracks for refinement */
+static void CreateRoiList(const std::vector<BoundingBox>& bbox_pred_list, int32_t image_w, int32_t image_h, std::vector<cv::Rect>& roi_list)
+{
+    roi_list.clear();
+    const cv::Rect image_rect(0, 0, image_w, image_h);
+    for (const auto& bbox : bbox_pred_list) {
+        int32_t margin_x = static_cast<int32_t>(bbox.w * ROI_MARGIN_RATIO);
+        int32_t margin_y = static_cast<int32_t>(bbox.h * ROI_MARGIN_RATIO);
+        cv::Rect roi = cv::Rect(bbox.x - margin_x, bbox.y - margin_y, bbox.w + margin_x * 2, bbox.h + margin_y * 2) & image_rect;
+        if (roi.width <= 0 || roi.height <= 0) continue;
+        roi_list.push_back(roi);
+    }
+}
+
+/* Apply the operating point decided by the quality controller to the engine and the detection interval */
+static void ApplyOperatingPoint(const QualityController::OperatingPoint& point)
+{
+    if (s_engine->SetInputSize(point.input_width, point.input_height) != DetectionEngine::kRetOk) {
+        PRINT_E("Failed to change input size\n");
+    }
+    s_engine->SetCandidateMax(point.candidate_max);
+    s_detection_interval_max = point.detection_interval;
+    s_detection_interval = (std::min)(s_detection_interval, s_detection_interval_max);
+}
+
+static inline int16_t SaturateInt16(int32_t val)
+{
+    return static_cast<int16_t>((std::min)((std::max)(val, static_cast<int32_t>(INT16_MIN)), static_cast<int32_t>(INT16_MAX)));
+}
+
 int32_t ImageProcessor::Initialize(const ImageProcessor::InputParam& input_param)
 {
     if (s_engine) {
@@ -78,12 +144,36 @@ int32_t ImageProcessor::Initialize(const ImageProcessor::InputParam& input_param
         return -1;
     }
 
+    if (s_thread_placement.Initialize(input_param.cpu_affinity, input_param.num_threads) != ThreadPlacement::kRetOk) {
+        return -1;
+    }
+    s_thread_placement.Apply();
+
     s_engine.reset(new DetectionEngine());
-    if (s_engine->Initialize(input_param.work_dir, input_param.num_threads) != DetectionEngine::kRetOk) {
+    s_engine->SetInt8(input_param.is_int8 != 0);
+    if (input_param.input_width > 0 && input_param.input_height > 0) {
+        if (s_engine->SetInputSize(input_param.input_width, input_param.input_height) != DetectionEngine::kRetOk) {
+            s_engine.reset();
+            return -1;
+        }
+    }
+    if (s_engine->Initialize(input_param.work_dir, s_thread_placement.GetThreadNum(), input_param.num_warmup) != DetectionEngine::kRetOk) {
         s_engine->Finalize();
         s_engine.reset();
         return -1;
     }
+
+    s_tracker.Reset();
+    s_detection_interval_max = (std::max)(input_param.detection_interval, 1);
+    s_is_detection_interval_adaptive = input_param.is_detection_interval_adaptive != 0;
+    s_detection_interval = 1;
+    s_frame_cnt_from_detection = 0;
+    s_is_roi_refinement = input_param.is_roi_refinement != 0;
+
+    s_engine->GetInputSize(s_best_point.input_width, s_best_point.input_height);
+    s_best_point.detection_interval = s_detection_interval_max;
+    s_best_point.candidate_max = 0;
+    s_quality_controller.Initialize(input_param.latency_budget, s_best_point);
     return 0;
 }
 
@@ -118,40 +208,152 @@ int32_t ImageProcessor::Command(int32_t cmd)
 }
 
 
+int32_t ImageProcessor::SetInputSize(int32_t width, int32_t height)
+{
+    if (!s_engine) {
+        PRINT_E("Not initialized\n");
+        return -1;
+    }
+    if (s_engine->SetInputSize(width, height) != DetectionEngine::kRetOk) {
+        return -1;
+    }
+
+    /* The new size is regarded as the best quality. The other knobs of the best point are kept, and the controller restarts from the level 0 */
+    s_best_point.input_width = width;
+    s_best_point.input_height = height;
+    s_quality_controller.Initialize(s_quality_controller.GetBudget(), s_best_point);
+    ApplyOperatingPoint(s_quality_controller.GetOperatingPoint());
+    return 0;
+}
+
+
+int32_t ImageProcessor::GetOperatingPoint(OperatingPoint& operating_point)
+{
+    if (!s_engine) {
+        PRINT_E("Not initialized\n");
+        return -1;
+    }
+    const auto& point = s_quality_controller.GetOperatingPoint();
+    operating_point.level = s_quality_controller.GetLevel();
+    operating_point.input_width = point.input_width;
+    operating_point.input_height = point.input_height;
+    operating_point.detection_interval = point.detection_interval;
+    operating_point.candidate_max = point.candidate_max;
+    return 0;
+}
+
+
+const char* ImageProcessor::GetLabel(int32_t class_id)
+{
+    if (!s_engine) {
+        PRINT_E("Not initialized\n");
+        return "";
+    }
+    return s_engine->GetLabel(class_id);
+}
+
+
 
-int32_t ImageProcessor::Process(cv::Mat& mat, ImageProcessor::Result& result)
+int32_t ImageProcessor::Process(cv::Mat& mat, ImageProcessor::Result& result, double timestamp)
 {
     if (!s_engine) {
         PRINT_E("Not initialized\n");
         return -1;
     }
+    s_thread_placement.Apply();
 
+    /* Run detection every s_detection_interval frames. Only tracker predicts the position at the other frames */
     DetectionEngine::Result det_result;
-    if (s_engine->Process(mat, det_result) != DetectionEngine::kRetOk) {
-        return -1;
+    bool is_detection_frame = s_frame_cnt_from_detection + 1 >= s_detection_interval;
+    if (is_detection_frame) {
+        if (s_engine->Process(mat, det_result) != DetectionEngine::kRetOk) {
+            return -1;
+        }
+        s_frame_cnt_from_detection = 0;
+    } else {
+        det_result.time_pre_process = 0;
+        det_result.time_inference = 0;
+        det_result.time_post_process = 0;
+        s_frame_cnt_from_detection++;
     }
 
-    /* Display target area  */
-    cv::rectangle(mat, cv::Rect(det_result.crop.x, det_result.crop.y, det_result.crop.w, det_result.crop.h), CommonHelper::CreateCvColor(0, 0, 0), 2);
+    /* At the skipped frames, run detection only around the positions where the tracks are predicted at this frame */
+    bool is_roi_frame = false;
+    if (!is_detection_frame && s_is_roi_refinement) {
+        if (timestamp < 0) {
+            s_tracker.GetPredictedBoundingBoxList(s_bbox_pred_list);
+        } else {
+            s_tracker.GetPredictedBoundingBoxList(timestamp, s_bbox_pred_list);
+        }
+        CreateRoiList(s_bbox_pred_list, mat.cols, mat.rows, s_roi_list);
+        if (static_cast<int32_t>(s_roi_list.size()) > DetectionEngine::kMosaicTileMax) {
+            /* Too many tracks to pack. Detect on the full frame rather than losing the tracks */
+            if (s_engine->Process(mat, det_result) != DetectionEngine::kRetOk) {
+                return -1;
+            }
+            s_frame_cnt_from_detection = 0;
+            is_detection_frame = true;
+        } else if (!s_roi_list.empty()) {
+            if (s_engine->ProcessMosaic(mat, s_roi_list, det_result) != DetectionEngine::kRetOk) {
+                return -1;
+            }
+            is_roi_frame = true;
+        }
+    }
+
+    /* Lower (or restore) quality when the processing time per frame exceeds (or is well within) the budget */
+    if (s_quality_controller.Update(det_result.time_inference + det_result.time_post_process, is_detection_frame || is_roi_frame)) {
+        ApplyOperatingPoint(s_quality_controller.GetOperatingPoint());
+    }
 
-    /* Display detection result (black rectangle) */
     int32_t num_det = 0;
-    for (const auto& bbox : det_result.bbox_list) {
-        cv::rectangle(mat, cv::Rect(bbox.x, bbox.y, bbox.w, bbox.h), CommonHelper::CreateCvColor(0, 0, 0), 1);
-        num_det++;
+    if (is_roi_frame) {
+        /* Display ROIs  */
+        for (const auto& roi : s_roi_list) {
+            cv::rectangle(mat, roi, CommonHelper::CreateCvColor(0, 0, 0), 1);
+        }
+        for (const auto& bbox : det_result.bbox_list) {
+            cv::rectangle(mat, cv::Rect(bbox.x, bbox.y, bbox.w, bbox.h), CommonHelper::CreateCvColor(0, 0, 0), 1);
+            num_det++;
+        }
+    }
+    if (is_detection_frame) {
+        /* Display target area  */
+        cv::rectangle(mat, cv::Rect(det_result.crop.x, det_result.crop.y, det_result.crop.w, det_result.crop.h), CommonHelper::CreateCvColor(0, 0, 0), 2);
+
+        /* Display detection result (black rectangle) */
+        for (const auto& bbox : det_result.bbox_list) {
+            cv::rectangle(mat, cv::Rect(bbox.x, bbox.y, bbox.w, bbox.h), CommonHelper::CreateCvColor(0, 0, 0), 1);
+            num_det++;
+        }
     }
 
     /* Display tracking result  */
-    s_tracker.Update(det_result.bbox_list);
+    if (is_detection_frame || is_roi_frame) {
+        if (timestamp < 0) {
+            s_tracker.Update(det_result.bbox_list);
+        } else {
+            s_tracker.Update(det_result.bbox_list, timestamp);
+        }
+    } else {
+        if (timestamp < 0) {
+            s_tracker.Predict();
+        } else {
+            s_tracker.Predict(timestamp);
+        }
+    }
     int32_t num_track = 0;
-    auto& track_list = s_tracker.GetTrackList();
+    auto track_list = s_tracker.GetTrackList();
+    if (is_detection_frame) {
+        s_detection_interval = DecideDetectionInterval(track_list);
+    }
     for (auto& track : track_list) {
         if (track.GetDetectedCount() < 2) continue;
         const auto& bbox = track.GetLatestData().bbox;
         /* Use white rectangle for the object which was not detected but just predicted */
         cv::Scalar color = bbox.score == 0 ? CommonHelper::CreateCvColor(255, 255, 255) : GetColorForId(track.GetId());
         cv::rectangle(mat, cv::Rect(bbox.x, bbox.y, bbox.w, bbox.h), color, 2);
-        CommonHelper::DrawText(mat, std::to_string(track.GetId()) + ": " + bbox.label, cv::Point(bbox.x, bbox.y), 0.35, 1, CommonHelper::CreateCvColor(0, 0, 0), CommonHelper::CreateCvColor(220, 220, 220));
+        CommonHelper::DrawText(mat, std::to_string(track.GetId()) + ": " + s_engine->GetLabel(bbox.class_id), cv::Point(bbox.x, bbox.y), 0.35, 1, CommonHelper::CreateCvColor(0, 0, 0), CommonHelper::CreateCvColor(220, 220, 220));
 
         auto& track_history = track.GetDataHistory();
         for (size_t i = 1; i < track_history.size(); i++) {
@@ -161,26 +363,26 @@ int32_t ImageProcessor::Process(cv::Mat& mat, ImageProcessor::Result& result)
         }
         num_track++;
     }
-    CommonHelper::DrawText(mat, "DET: " + std::to_string(num_det) + ", TRACK: " + std::to_string(num_track), cv::Point(0, 20), 0.7, 2, CommonHelper::CreateCvColor(0, 0, 0), CommonHelper::CreateCvColor(220, 220, 220));
+    CommonHelper::DrawText(mat, (is_detection_frame ? "DET: " + std::to_string(num_det) : (is_roi_frame ? "DET(ROI): " + std::to_string(num_det) : std::string("DET: skip"))) + ", TRACK: " + std::to_string(num_track), cv::Point(0, 20), 0.7, 2, CommonHelper::CreateCvColor(0, 0, 0), CommonHelper::CreateCvColor(220, 220, 220));
 
     DrawFps(mat, det_result.time_inference, cv::Point(0, 0), 0.5, 2, CommonHelper::CreateCvColor(0, 0, 0), CommonHelper::CreateCvColor(180, 180, 180), true);
 
     /* Return the results */
-    int32_t bbox_num = 0;
+    result.object_list.clear();
     for (auto& track : track_list) {
         const auto& bbox = track.GetLatestData().bbox;
-        result.object_list[bbox_num].class_id = bbox.class_id;
-        snprintf(result.object_list[bbox_num].label, sizeof(result.object_list[bbox_num].label), "%s", bbox.label.c_str());
-        result.object_list[bbox_num].score = bbox.score;
-        result.object_list[bbox_num].x = bbox.x;
-        result.object_list[bbox_num].y = bbox.y;
-        result.object_list[bbox_num].width = bbox.w;
-        result.object_list[bbox_num].height = bbox.h;
-        bbox_num++;
-        if (bbox_num >= NUM_MAX_RESULT) break;
-    }
-    result.object_num = bbox_num;
+        Object object;
+        object.class_id = static_cast<int16_t>(bbox.class_id);
+        object.x = SaturateInt16(bbox.x);
+        object.y = SaturateInt16(bbox.y);
+        object.width = SaturateInt16(bbox.w);
+        object.height = SaturateInt16(bbox.h);
+        object.is_predicted = bbox.score == 0 ? 1 : 0;    /* score is 0 when the position is predicted */
+        object.score = bbox.score;
+        result.object_list.push_back(object);
+    }
 
+    result.is_detected = is_detection_frame ? 1 : (is_roi_frame ? 2 : 0);
     result.time_pre_process = det_result.time_pre_process;
     result.time_inference = det_result.time_inference;
     result.time_post_process = det_result.time_post_process;
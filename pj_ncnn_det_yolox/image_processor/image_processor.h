@@ -26,36 +26,59 @@ namespace cv {
     class Mat;
 };
 
-#define NUM_MAX_RESULT 100
-
 namespace ImageProcessor
 {
 
 typedef struct {
     char     work_dir[256];
-    int32_t  num_threads;
+    int32_t  num_threads;       /* 0: the number of cores in cpu_affinity (all cores when not pinned) */
+    int32_t  num_warmup;        /* number of dummy inferences in Initialize (0: no warm-up) */
+    char     cpu_affinity[32];  /* Pin inference threads to cores. "": not pinned, "all", "big", "little", or core list (e.g. "4-7") */
+    int32_t  input_width;       /* model input size (0: default size of the model). Must be multiples of 32 */
+    int32_t  input_height;
+    int32_t  is_int8;           /* Use the int8 quantized model (yolox_int8.param/bin) */
+    int32_t  detection_interval;            /* Run detection every N frames, and only tracker predicts the other frames (0, 1: every frame) */
+    int32_t  is_detection_interval_adaptive; /* Use detection_interval as the max, and decrease it when tracks are unstable or move fast */
+    int32_t  is_roi_refinement;             /* Run detection on areas around tracks at the frames skipped by detection_interval */
+    int32_t  latency_budget;                /* [msec] Target of inference + post process time per frame (average). Quality is lowered step by step when exceeded (0: disabled) */
 } InputParam;
 
+/* Packed object (16 Byte). Use GetLabel(class_id) to get the label string */
+typedef struct {
+    int16_t  class_id;
+    int16_t  x;
+    int16_t  y;
+    int16_t  width;
+    int16_t  height;
+    int16_t  is_predicted;   /* 1: not detected at this frame, and the position is predicted by tracker */
+    float    score;
+} Object;
+static_assert(sizeof(Object) == 16, "ImageProcessor::Object must be packed into 16 Byte");
+
+/* Current quality settings decided by latency_budget */
+typedef struct {
+    int32_t  level;                 /* 0: the best quality */
+    int32_t  input_width;
+    int32_t  input_height;
+    int32_t  detection_interval;
+    int32_t  candidate_max;         /* max number of boxes before NMS (0: no limit) */
+} OperatingPoint;
+
 typedef struct {
-    int32_t object_num;
-    struct {
-        int32_t  class_id;
-        char     label[256];
-        double   score;
-        int32_t  x;
-        int32_t  y;
-        int32_t  width;
-        int32_t  height;
-    } object_list[NUM_MAX_RESULT];
+    std::vector<Object> object_list;    /* Re-use the same Result across frames to avoid reallocation */
+    int32_t is_detected;    /* 0: detection was skipped at this frame, 1: detection on the whole frame, 2: detection only around tracks */
     double time_pre_process;   // [msec]
     double time_inference;    // [msec]
     double time_post_process;  // [msec]
 } Result;
 
 int32_t Initialize(const InputParam& input_param);
-int32_t Process(cv::Mat& mat, Result& result);
+int32_t Process(cv::Mat& mat, Result& result, double timestamp = -1);  /* timestamp [sec] of the frame is used for tracking with dropped frames. (-1: regard as the next frame) */
 int32_t Finalize(void);
 int32_t Command(int32_t cmd);
+int32_t SetInputSize(int32_t width, int32_t height);     /* change the model input size between frames */
+const char* GetLabel(int32_t class_id);
+int32_t GetOperatingPoint(OperatingPoint& operating_point);
 
 }
 
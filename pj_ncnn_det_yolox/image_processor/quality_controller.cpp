@@ -0,0 +1,135 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+/*** Include ***/
+/* for general */
+#include <cstdint>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+/* for My modules */
+#include "common_helper.h"
+#include "quality_controller.h"
+
+/*** Macro ***/
+#define TAG "QualityController"
+#define PRINT(...)   COMMON_HELPER_PRINT(TAG, __VA_ARGS__)
+#define PRINT_E(...) COMMON_HELPER_PRINT_E(TAG, __VA_ARGS__)
+
+#define INPUT_SIZE_UNIT     32      /* input size must be multiples of the max grid scale */
+#define CANDIDATE_MAX_LOW   300
+
+/* Steps from the best operating point. Cheap knobs (candidate cap, detection interval) are used before reducing input size */
+typedef struct {
+    float   input_scale;
+    int32_t detection_interval_add;
+    int32_t candidate_max;      /* 0: the same as the best point */
+} Step;
+static constexpr Step kStepList[] = {
+    { 1.0f, 0, 0 },
+    { 1.0f, 0, CANDIDATE_MAX_LOW },
+    { 1.0f, 1, CANDIDATE_MAX_LOW },
+    { 0.8f, 1, CANDIDATE_MAX_LOW },
+    { 0.8f, 2, CANDIDATE_MAX_LOW },
+    { 0.6f, 2, CANDIDATE_MAX_LOW },
+    { 0.5f, 3, CANDIDATE_MAX_LOW },
+};
+
+constexpr int32_t QualityController::kWindowSize;
+constexpr double QualityController::kUpgradeRatio;
+
+/*** Function ***/
+static inline int32_t ScaleInputSize(int32_t size, float scale)
+{
+    int32_t size_scaled = static_cast<int32_t>(size * scale) / INPUT_SIZE_UNIT * INPUT_SIZE_UNIT;
+    return (std::max)(size_scaled, INPUT_SIZE_UNIT);
+}
+
+void QualityController::Initialize(double budget, const OperatingPoint& best_point)
+{
+    budget_ = budget;
+    level_ = 0;
+    time_history_.clear();
+    frame_history_.clear();
+    frame_cnt_ = 0;
+    point_list_.clear();
+    for (const auto& step : kStepList) {
+        OperatingPoint point = best_point;
+        if (step.input_scale < 1.0f) {
+            point.input_width = ScaleInputSize(best_point.input_width, step.input_scale);
+            point.input_height = ScaleInputSize(best_point.input_height, step.input_scale);
+        }
+        point.detection_interval = best_point.detection_interval + step.detection_interval_add;
+        if (step.candidate_max > 0 && (best_point.candidate_max <= 0 || step.candidate_max < best_point.candidate_max)) {
+            point.candidate_max = step.candidate_max;
+        }
+        /* Skip the step which doesn't change anything (e.g. input size is already small) */
+        if (!point_list_.empty()) {
+            const auto& prev = point_list_.back();
+            if (prev.input_width == point.input_width && prev.input_height == point.input_height
+                && prev.detection_interval == point.detection_interval && prev.candidate_max == point.candidate_max) continue;
+        }
+        point_list_.push_back(point);
+    }
+}
+
+/* Processing time is measured per detection, and divided by the number of frames the detections cover */
+/* Skipped frames are not added as 0 [msec], so the average doesn't depend on where the window starts in the detection interval */
+bool QualityController::Update(double time_process, bool is_detected)
+{
+    if (!IsEnabled()) return false;
+    frame_cnt_++;
+    if (!is_detected) return false;
+    time_history_.push_back(time_process);
+    frame_history_.push_back(frame_cnt_);
+    frame_cnt_ = 0;
+    if (static_cast<int32_t>(time_history_.size()) < kWindowSize) return false;
+
+    double time_sum = 0;
+    int32_t frame_sum = 0;
+    for (size_t i = 0; i < time_history_.size(); i++) {
+        time_sum += time_history_[i];
+        frame_sum += frame_history_[i];
+    }
+    double time_per_frame = time_sum / frame_sum;
+
+    /* Step up only when the upper level is expected to be within the budget (hysteresis). Otherwise it steps down again right after */
+    int32_t level_new = level_;
+    if (time_per_frame > budget_ && level_ < GetLevelNum() - 1) {
+        level_new = level_ + 1;
+    } else if (level_ > 0 && EstimateTimePerFrame(level_ - 1, time_per_frame) < budget_ * kUpgradeRatio) {
+        level_new = level_ - 1;
+    }
+    if (level_new == level_) return false;
+
+    PRINT("Level %d -> %d (average = %.1f [msec], budget = %.1f [msec])\n", level_, level_new, time_per_frame, budget_);
+    level_ = level_new;
+    time_history_.clear();      /* measure the new operating point from scratch */
+    frame_history_.clear();
+    frame_cnt_ = 0;
+    return true;
+}
+
+/* Time per frame at the level, estimated from the current level. Detection time is regarded as proportional to the input area, and is divided by the detection interval */
+/* Time of candidate_max is ignored. The estimate is conservative with ROI refinement (ROI frames are not free) */
+double QualityController::EstimateTimePerFrame(int32_t level, double time_per_frame) const
+{
+    const OperatingPoint& point_current = point_list_[level_];
+    const OperatingPoint& point = point_list_[level];
+    double area_ratio = static_cast<double>(point.input_width) * point.input_height / (static_cast<double>(point_current.input_width) * point_current.input_height);
+    double interval_ratio = static_cast<double>(point_current.detection_interval) / point.detection_interval;
+    return time_per_frame * area_ratio * interval_ratio;
+}
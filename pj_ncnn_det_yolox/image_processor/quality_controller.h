@@ -0,0 +1,67 @@
+/* Copyright 2021 iwatake2222
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef QUALITY_CONTROLLER_
+#define QUALITY_CONTROLLER_
+
+/* for general */
+#include <cstdint>
+#include <vector>
+
+/* for My modules */
+#include "ring_buffer.h"
+
+/* Keep the processing time within the budget by stepping the operating point down (lower quality) or up (higher quality) one level at a time */
+/* Levels are created from the best operating point: 0 is the best, and each level changes one knob from the previous level */
+class QualityController {
+public:
+    typedef struct OperatingPoint_ {
+        int32_t input_width;
+        int32_t input_height;
+        int32_t detection_interval;
+        int32_t candidate_max;      /* 0: no limit */
+    } OperatingPoint;
+
+private:
+    static constexpr int32_t kWindowSize = 8;           /* number of detections averaged to decide */
+    static constexpr double kUpgradeRatio = 0.8;        /* step up when the time expected at the upper level is less than budget * ratio */
+
+public:
+    QualityController() : budget_(0), level_(0), frame_cnt_(0) {}
+    ~QualityController() {}
+
+    /* budget [msec] <= 0 disables the controller */
+    void Initialize(double budget, const OperatingPoint& best_point);
+    /* Add the processing time [msec] of a frame. is_detected is false at the frames skipped by detection interval. Return true if the operating point is changed */
+    bool Update(double time_process, bool is_detected);
+
+    bool IsEnabled() const { return budget_ > 0; }
+    double GetBudget() const { return budget_; }
+    int32_t GetLevel() const { return level_; }
+    int32_t GetLevelNum() const { return static_cast<int32_t>(point_list_.size()); }
+    const OperatingPoint& GetOperatingPoint() const { return point_list_[level_]; }
+
+private:
+    double EstimateTimePerFrame(int32_t level, double time_per_frame) const;
+
+private:
+    double budget_;
+    int32_t level_;
+    std::vector<OperatingPoint> point_list_;
+    RingBuffer<double, kWindowSize> time_history_;      /* processing time of each detection */
+    RingBuffer<int32_t, kWindowSize> frame_history_;    /* number of frames covered by each detection (1 + skipped frames before it) */
+    int32_t frame_cnt_;     /* frames skipped since the last detection */
+};
+
+#endif
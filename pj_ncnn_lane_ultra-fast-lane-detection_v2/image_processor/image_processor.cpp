@@ -32,6 +32,7 @@ limitations under the License.
 /* for My modules */
 #include "common_helper.h"
 #include "common_helper_cv.h"
+#include "thread_placement.h"
 #include "bounding_box.h"
 #include "lane_engine.h"
 #include "tracker.h"
@@ -44,6 +45,7 @@ limitations under the License.
 
 /*** Global variable ***/
 std::unique_ptr<LaneEngine> s_engine;
+ThreadPlacement s_thread_placement;
 CommonHelper::NiceColorGenerator s_nice_color_generator(4);
 
 /*** Function ***/
@@ -65,8 +67,13 @@ int32_t ImageProcessor::Initialize(const ImageProcessor::InputParam& input_param
         return -1;
     }
 
+    if (s_thread_placement.Initialize(input_param.cpu_affinity, input_param.num_threads) != ThreadPlacement::kRetOk) {
+        return -1;
+    }
+    s_thread_placement.Apply();
+
     s_engine.reset(new LaneEngine());
-    if (s_engine->Initialize(input_param.work_dir, input_param.num_threads) != LaneEngine::kRetOk) {
+    if (s_engine->Initialize(input_param.work_dir, s_thread_placement.GetThreadNum(), input_param.num_warmup) != LaneEngine::kRetOk) {
         s_engine->Finalize();
         s_engine.reset();
         return -1;
@@ -112,6 +119,7 @@ int32_t ImageProcessor::Process(cv::Mat& mat, ImageProcessor::Result& result)
         PRINT_E("Not initialized\n");
         return -1;
     }
+    s_thread_placement.Apply();
 
     LaneEngine::Result engine_result;
     if (s_engine->Process(mat, engine_result) != LaneEngine::kRetOk) {
@@ -32,6 +32,7 @@ limitations under the License.
 #include "common_helper.h"
 #include "common_helper_cv.h"
 #include "inference_helper.h"
+#include "model_bundle.h"
 #include "lane_engine.h"
 
 /*** Macro ***/
@@ -63,6 +64,7 @@ limitations under the License.
 #define OUTPUT_NAME_1 "loc_col"
 #define OUTPUT_NAME_2 "exist_row"
 #define OUTPUT_NAME_3 "exist_col"
+#define BUNDLE_NAME   "ufldv2.bundle"     /* model information in the bundle is used instead of the values above if exists */
 
 #if defined(USE_CULANE)
 static constexpr int32_t kNumRow = 72;
@@ -96,10 +98,18 @@ void LaneEngine::GenerateAnchor()
 }
 
 /*** Function ***/
-int32_t LaneEngine::Initialize(const std::string& work_dir, const int32_t num_threads)
+int32_t LaneEngine::Initialize(const std::string& work_dir, const int32_t num_threads, const int32_t num_warmup)
 {
     /* Set model information */
     std::string model_filename = work_dir + "/model/" + MODEL_NAME;
+    ModelBundle bundle;
+    const std::string bundle_filename = work_dir + "/model/" + BUNDLE_NAME;
+    if (std::ifstream(bundle_filename).good()) {
+        if (bundle.Open(bundle_filename) != ModelBundle::kRetOk) {
+            return kRetErr;
+        }
+        model_filename = work_dir + "/model/" + bundle.GetMeta("model_file", MODEL_NAME);
+    }
 
     /* Set input tensor info */
     input_tensor_info_list_.clear();
@@ -113,19 +123,22 @@ int32_t LaneEngine::Initialize(const std::string& work_dir, const int32_t num_th
     input_tensor_info.normalize.norm[0] = 0.229f;
     input_tensor_info.normalize.norm[1] = 0.224f;
     input_tensor_info.normalize.norm[2] = 0.225f;
+    is_rgb_ = IS_RGB;
+    std::vector<std::string> output_name_list = { OUTPUT_NAME_0, OUTPUT_NAME_1, OUTPUT_NAME_2, OUTPUT_NAME_3 };
+#if defined(USE_CULANECURVELANES)
+    output_name_list.push_back("282");
+    output_name_list.push_back("288");
+#endif
+    if (bundle.IsOpened() && bundle.GetModelInfo(input_tensor_info.name, input_tensor_info.tensor_dims, input_tensor_info.normalize.mean, input_tensor_info.normalize.norm, is_rgb_, output_name_list) != ModelBundle::kRetOk) {
+        return kRetErr;
+    }
     input_tensor_info_list_.push_back(input_tensor_info);
 
     /* Set output tensor info */
     output_tensor_info_list_.clear();
-    output_tensor_info_list_.push_back(OutputTensorInfo(OUTPUT_NAME_0, TENSORTYPE));
-    output_tensor_info_list_.push_back(OutputTensorInfo(OUTPUT_NAME_1, TENSORTYPE));
-    output_tensor_info_list_.push_back(OutputTensorInfo(OUTPUT_NAME_2, TENSORTYPE));
-    output_tensor_info_list_.push_back(OutputTensorInfo(OUTPUT_NAME_3, TENSORTYPE));
-    
-#if defined(USE_CULANECURVELANES)
-    output_tensor_info_list_.push_back(OutputTensorInfo("282", TENSORTYPE));
-    output_tensor_info_list_.push_back(OutputTensorInfo("288", TENSORTYPE));
-#endif
+    for (const auto& output_name : output_name_list) {
+        output_tensor_info_list_.push_back(OutputTensorInfo(output_name, TENSORTYPE));
+    }
 
     /* Create and Initialize Inference Helper */
     inference_helper_.reset(InferenceHelper::Create(InferenceHelper::kNcnn));
@@ -145,6 +158,33 @@ int32_t LaneEngine::Initialize(const std::string& work_dir, const int32_t num_th
 
     GenerateAnchor();
 
+    if (Warmup(num_warmup) != kRetOk) {
+        PRINT_E("Warm-up failed\n");
+        return kRetErr;
+    }
+
+    return kRetOk;
+}
+
+int32_t LaneEngine::Warmup(int32_t num_warmup)
+{
+    InputTensorInfo& input_tensor_info = input_tensor_info_list_[0];
+    cv::Mat img_src = cv::Mat::zeros(input_tensor_info.GetHeight(), input_tensor_info.GetWidth(), CV_8UC3);
+    Result result;
+    if (!CommonHelper::Warmup(num_warmup, [&]() { return Process(img_src, result) == kRetOk; })) {
+        return kRetErr;
+    }
+    return kRetOk;
+}
+
+int32_t LaneEngine::SetLaneMask(uint32_t lane_mask_row, uint32_t lane_mask_col)
+{
+    if ((lane_mask_row & lane_mask_col) != 0) {
+        PRINT_E("Lane mask overlaps (row = 0x%X, col = 0x%X)\n", lane_mask_row, lane_mask_col);
+        return kRetErr;
+    }
+    lane_mask_row_ = lane_mask_row;
+    lane_mask_col_ = lane_mask_col;
     return kRetOk;
 }
 
@@ -158,106 +198,93 @@ int32_t LaneEngine::Finalize()
     return kRetOk;
 }
 
-static std::vector<int32_t> argmax_1(const std::vector<float>& v, const std::vector<int32_t>& dims)
+/* argmax along the grid axis: (1 x num_grid x num_cls x num_lane) -> (num_cls x num_lane) */
+/* The grid axis is the outer loop so that the tensor is read contiguously, and max / argmax of each (cls, lane) are updated in SIMD lanes */
+/* All lanes are calculated because lane is the innermost axis (skipping a lane doesn't save memory reads). Unused lanes are discarded in DecodeLane */
+void LaneEngine::ArgMaxGrid(const TensorView& v, std::vector<int32_t>& max_index_list)
 {
-    std::vector<int32_t> ret;
-    ret.resize(dims[0] * dims[2] * dims[3]);
-
-    for (int32_t i = 0; i < dims[2]; i++) {
-        for (int32_t j = 0; j < dims[3]; j++) {
-            int32_t offset = dims[3] * i + j;
-            float max_val = 0;
-            int32_t max_index = 0;
-            for (int32_t k = 0; k < dims[1]; k++) {
-                size_t index = k * dims[2] * dims[3] + offset;
-                if (v[index] > max_val) {
-                    max_val = v[index];
-                    max_index = k;
-                }
-            }
-            ret[offset] = max_index;
+    const int32_t plane_size = v.num_cls * v.num_lane;
+    max_index_list.assign(plane_size, 0);
+    max_val_buffer_.assign(v.data, v.data + plane_size);
+    int32_t* max_index = max_index_list.data();
+    float* max_val = max_val_buffer_.data();
+
+    for (int32_t k = 1; k < v.num_grid; k++) {
+        const float* src = v.data + k * plane_size;
+#pragma omp simd
+        for (int32_t i = 0; i < plane_size; i++) {
+            /* Select by arithmetic, because GCC doesn't vectorize the conditional (it's regarded as control flow) */
+            const int32_t is_larger = src[i] > max_val[i];
+            max_index[i] += (k - max_index[i]) * is_larger;
+            max_val[i] = (std::max)(src[i], max_val[i]);
         }
     }
-    return ret;
 }
 
-static int32_t sum_valid(const std::vector<int32_t>& v, int32_t num, int32_t interval, int32_t offset)
+/* Expected grid position using softmax around the max position (local_width = 1) */
+static float ExpectedPosition(const LaneEngine::TensorView& loc, int32_t max_index, int32_t cls, int32_t lane)
 {
-    int32_t sum = 0;
-    for (int32_t i = 0; i < num; i++) {
-        sum += v[i * interval + offset];
+    static constexpr int32_t kLocalWidth = 1;
+    float pred_all_list[kLocalWidth * 2 + 1];
+    float pred_all_list_softmax[kLocalWidth * 2 + 1];
+    const int32_t all_ind_start = std::max(0, max_index - kLocalWidth);
+    const int32_t all_ind_end = std::min(loc.num_grid - 1, max_index + kLocalWidth);
+    const int32_t num = all_ind_end - all_ind_start + 1;
+    for (int32_t l = 0; l < num; l++) {
+        pred_all_list[l] = loc(all_ind_start + l, cls, lane);
+    }
+    CommonHelper::SoftMaxFast(pred_all_list, pred_all_list_softmax, num);
+    float out_temp = 0;
+    for (int32_t l = 0; l < num; l++) {
+        out_temp += pred_all_list_softmax[l] * (all_ind_start + l);
     }
-    return sum;
+    return out_temp;
 }
 
 
-std::vector<LaneEngine::Line<float>> LaneEngine::Pred2Coords(const std::vector<float>& loc_row, const std::vector<int32_t>& loc_row_dims, const std::vector<float>& exist_row, const std::vector<int32_t>& exist_row_dims,
-                             const std::vector<float>& loc_col, const std::vector<int32_t>& loc_col_dims, const std::vector<float>& exist_col, const std::vector<int32_t>& exist_col_dims)
+/* Location is decoded only for lanes in lane_mask which have enough valid points. The other lanes are discarded here */
+void LaneEngine::DecodeLane(std::vector<Line<float>>& line_list, const TensorView& loc, const std::vector<int32_t>& valid, uint32_t lane_mask, int32_t threshold_valid_num, bool is_row_anchor)
 {
-    std::vector<Line<float>> line_list(4);
-
-    int32_t num_grid_row = loc_row_dims[1]; /* 200 */
-    int32_t num_cls_row = loc_row_dims[2];  /* 72 */
-    int32_t num_lane_row = loc_row_dims[3]; /* 4 */
-    int32_t num_grid_col = loc_col_dims[1];
-    int32_t num_cls_col = loc_col_dims[2];
-    int32_t num_lane_col = loc_col_dims[3];
-
-    auto max_indices_row = argmax_1(loc_row, loc_row_dims);  /* 1x200x72x4 -> 1x72x4 */
-    auto valid_row = argmax_1(exist_row, exist_row_dims);
-    auto max_indices_col = argmax_1(loc_col, loc_col_dims);
-    auto valid_col = argmax_1(exist_col, exist_col_dims);
-
-    for (int32_t i : { 1, 2 }) {
-        if (sum_valid(valid_row, num_cls_row, num_lane_row, i) > num_cls_row / 2) {
-            for (int32_t k = 0; k < num_cls_row; k++) {
-                int32_t index = k * num_lane_row + i;
-                if (valid_row[index] != 0) {
-                    /* all_ind = torch.tensor(list(range(max(0,max_indices_row[0,k,i] - local_width), min(num_grid_row-1, max_indices_row[0,k,i] + local_width) + 1))) */
-                    std::vector<float> pred_all_list;
-                    std::vector<int32_t> all_ind_list;
-                    for (int32_t all_ind = std::max(0, max_indices_row[index] - 1); all_ind <= std::min(num_grid_row - 1, max_indices_row[index] + 1); all_ind++) {
-                        pred_all_list.push_back(loc_row[all_ind * num_cls_row * num_lane_row + index]);
-                        all_ind_list.push_back(all_ind);
-                    }
-                    std::vector<float> pred_all_list_softmax(pred_all_list.size());
-                    CommonHelper::SoftMaxFast(pred_all_list.data(), pred_all_list_softmax.data(), pred_all_list.size());
-                    float out_temp = 0;
-                    for (int32_t l = 0; l < pred_all_list.size(); l++) {
-                        out_temp += pred_all_list_softmax[l] * all_ind_list[l];
-                    }
-                    float x = (out_temp + 0.5) / (num_grid_row - 1.0);
-                    float y = row_anchor_[k];
-                    line_list[i].push_back(std::pair<float, float>(x, y));
-                }
-            }
-        }
+    /* The number of valid points of all lanes is counted in one contiguous pass (lane is the innermost axis) */
+    valid_num_.assign(loc.num_lane, 0);
+    for (int32_t k = 0; k < loc.num_cls; k++) {
+        const int32_t* src = valid.data() + k * loc.num_lane;
+        for (int32_t lane = 0; lane < loc.num_lane; lane++) valid_num_[lane] += src[lane];
     }
-
-    for (int32_t i : {0, 3}) {
-        if (sum_valid(valid_col, num_cls_col, num_lane_col, i) > num_cls_col / 8) {
-            for (int32_t k = 0; k < num_cls_col; k++) {
-                int32_t index = k * num_lane_col + i;
-                if (valid_col[index] != 0) {
-                    std::vector<float> pred_all_list;
-                    std::vector<int32_t> all_ind_list;
-                    for (int32_t all_ind = std::max(0, max_indices_col[index] - 1); all_ind <= std::min(num_grid_col - 1, max_indices_col[index] + 1); all_ind++) {
-                        pred_all_list.push_back(loc_col[all_ind * num_cls_col * num_lane_col + index]);
-                        all_ind_list.push_back(all_ind);
-                    }
-                    std::vector<float> pred_all_list_softmax(pred_all_list.size());
-                    CommonHelper::SoftMaxFast(pred_all_list.data(), pred_all_list_softmax.data(), pred_all_list.size());
-                    float out_temp = 0;
-                    for (int32_t l = 0; l < pred_all_list.size(); l++) {
-                        out_temp += pred_all_list_softmax[l] * all_ind_list[l];
-                    }
-                    float y = (out_temp + 0.5) / (num_grid_col - 1.0);
-                    float x = col_anchor_[k];
-                    line_list[i].push_back(std::pair<float, float>(x, y));
-                }
+    uint32_t lane_mask_decode = 0;
+    for (int32_t lane = 0; lane < loc.num_lane; lane++) {
+        if (((lane_mask >> lane) & 1) == 0) continue;
+        if (valid_num_[lane] <= threshold_valid_num) continue;
+        lane_mask_decode |= 1u << lane;
+    }
+    if (lane_mask_decode == 0) return;
+
+    ArgMaxGrid(loc, max_indices_);  /* 1x200x72x4 -> 1x72x4 */
+    for (int32_t lane = 0; lane < loc.num_lane; lane++) {
+        if (((lane_mask_decode >> lane) & 1) == 0) continue;
+        for (int32_t k = 0; k < loc.num_cls; k++) {
+            if (valid[k * loc.num_lane + lane] == 0) continue;
+            /* all_ind = torch.tensor(list(range(max(0,max_indices_row[0,k,i] - local_width), min(num_grid_row-1, max_indices_row[0,k,i] + local_width) + 1))) */
+            float out_temp = ExpectedPosition(loc, max_indices_[k * loc.num_lane + lane], k, lane);
+            float pos = (out_temp + 0.5f) / (loc.num_grid - 1.0f);
+            if (is_row_anchor) {
+                line_list[lane].push_back(std::pair<float, float>(pos, row_anchor_[k]));
+            } else {
+                line_list[lane].push_back(std::pair<float, float>(col_anchor_[k], pos));
             }
         }
     }
+}
+
+std::vector<LaneEngine::Line<float>> LaneEngine::Pred2Coords(const TensorView& loc_row, const TensorView& exist_row, const TensorView& loc_col, const TensorView& exist_col)
+{
+    std::vector<Line<float>> line_list((std::max)(loc_row.num_lane, loc_col.num_lane));
+
+    /* Calculate validity first, then calculate location only for lanes to be used */
+    ArgMaxGrid(exist_row, valid_row_);  /* 1x2x72x4 -> 1x72x4 */
+    ArgMaxGrid(exist_col, valid_col_);
+    DecodeLane(line_list, loc_row, valid_row_, lane_mask_row_, loc_row.num_cls / 2, true);
+    DecodeLane(line_list, loc_col, valid_col_, lane_mask_col_, loc_col.num_cls / 8, false);
 
     return line_list;
 }
@@ -286,7 +313,7 @@ int32_t LaneEngine::Process(const cv::Mat& original_mat, Result& result)
     int32_t crop_h = original_mat.rows * 1.0;
 #endif
     cv::Mat img_src = cv::Mat::zeros(input_tensor_info.GetHeight(), input_tensor_info.GetWidth(), CV_8UC3);
-    CommonHelper::CropResizeCvt(original_mat, img_src, crop_x, crop_y, crop_w, crop_h, IS_RGB, CommonHelper::kCropTypeStretch);
+    CommonHelper::CropResizeCvt(original_mat, img_src, crop_x, crop_y, crop_w, crop_h, is_rgb_, CommonHelper::kCropTypeStretch);
     //CommonHelper::CropResizeCvt(original_mat, img_src, crop_x, crop_y, crop_w, crop_h, IS_RGB, CommonHelper::kCropTypeCut);
     //CommonHelper::CropResizeCvt(original_mat, img_src, crop_x, crop_y, crop_w, crop_h, IS_RGB, CommonHelper::kCropTypeExpand);
 
@@ -315,16 +342,13 @@ int32_t LaneEngine::Process(const cv::Mat& original_mat, Result& result)
 
     /*** PostProcess ***/
     const auto& t_post_process0 = std::chrono::steady_clock::now();
-    std::vector<float> loc_row(output_tensor_info_list_[0].GetDataAsFloat(), output_tensor_info_list_[0].GetDataAsFloat() + output_tensor_info_list_[0].GetElementNum());
-    std::vector<float> loc_col(output_tensor_info_list_[1].GetDataAsFloat(), output_tensor_info_list_[1].GetDataAsFloat() + output_tensor_info_list_[1].GetElementNum());
-    std::vector<float> exist_row(output_tensor_info_list_[2].GetDataAsFloat(), output_tensor_info_list_[2].GetDataAsFloat() + output_tensor_info_list_[2].GetElementNum());
-    std::vector<float> exist_col(output_tensor_info_list_[3].GetDataAsFloat(), output_tensor_info_list_[3].GetDataAsFloat() + output_tensor_info_list_[3].GetElementNum());
-    std::vector<int32_t> loc_row_dims = output_tensor_info_list_[0].tensor_dims;
-    std::vector<int32_t> loc_col_dims = output_tensor_info_list_[1].tensor_dims;
-    std::vector<int32_t> exist_row_dims = output_tensor_info_list_[2].tensor_dims;
-    std::vector<int32_t> exist_col_dims = output_tensor_info_list_[3].tensor_dims;
-
-    auto line_list = Pred2Coords(loc_row, loc_row_dims, exist_row, exist_row_dims, loc_col, loc_col_dims, exist_col, exist_col_dims);
+    /* Read output tensors directly (no copy) */
+    TensorView loc_row(output_tensor_info_list_[0].GetDataAsFloat(), output_tensor_info_list_[0].tensor_dims);
+    TensorView loc_col(output_tensor_info_list_[1].GetDataAsFloat(), output_tensor_info_list_[1].tensor_dims);
+    TensorView exist_row(output_tensor_info_list_[2].GetDataAsFloat(), output_tensor_info_list_[2].tensor_dims);
+    TensorView exist_col(output_tensor_info_list_[3].GetDataAsFloat(), output_tensor_info_list_[3].tensor_dims);
+
+    auto line_list = Pred2Coords(loc_row, exist_row, loc_col, exist_col);
 
     /* todo: I'm not sure the following code correct */
     /* Adjust height scale : https://github.com/cfzd/Ultra-Fast-Lane-Detection-v2/blob/c80276bc2fd67d02579b6eeb57a76cb5a905aa3d/demo.py#L88 */
@@ -41,6 +41,17 @@ public:
     template <typename T> 
     using Line = std::vector<std::pair<T, T>>;
 
+    /* View of output tensor (1 x num_grid x num_cls x num_lane) to read it without copy */
+    typedef struct TensorView_ {
+        const float* data;
+        int32_t num_grid;
+        int32_t num_cls;
+        int32_t num_lane;
+        TensorView_() : data(nullptr), num_grid(0), num_cls(0), num_lane(0) {}
+        TensorView_(const float* _data, const std::vector<int32_t>& dims) : data(_data), num_grid(dims[1]), num_cls(dims[2]), num_lane(dims[3]) {}
+        float operator() (int32_t grid, int32_t cls, int32_t lane) const { return data[(grid * num_cls + cls) * num_lane + lane]; }
+    } TensorView;
+
     typedef struct Result_ {
         std::vector<Line<int32_t>> line_list;
         struct crop_ {
@@ -58,26 +69,46 @@ public:
     } Result;
 
 public:
-    LaneEngine() {}
+    LaneEngine() {
+        is_rgb_ = true;
+        lane_mask_row_ = (1 << 1) | (1 << 2);
+        lane_mask_col_ = (1 << 0) | (1 << 3);
+    }
     ~LaneEngine() {}
-    int32_t Initialize(const std::string& work_dir, const int32_t num_threads);
+    int32_t Initialize(const std::string& work_dir, const int32_t num_threads, const int32_t num_warmup = 0);
     int32_t Finalize(void);
     int32_t Process(const cv::Mat& original_mat, Result& result);
+    /* Lanes to be decoded (bit i = lane i). Default: lane 1, 2 by row anchor, lane 0, 3 by column anchor */
+    /* A lane is decoded by either row anchor or column anchor. Overlapping masks are rejected, because points of both anchors would be mixed in one line */
+    int32_t SetLaneMask(uint32_t lane_mask_row, uint32_t lane_mask_col);
 
     void GenerateAnchor();
-    std::vector<Line<float>> Pred2Coords(const std::vector<float>& loc_row, const std::vector<int32_t>& loc_row_dims, const std::vector<float>& exist_row, const std::vector<int32_t>& exist_row_dims,
-        const std::vector<float>& loc_col, const std::vector<int32_t>& loc_col_dims, const std::vector<float>& exist_col, const std::vector<int32_t>& exist_col_dims);
+    std::vector<Line<float>> Pred2Coords(const TensorView& loc_row, const TensorView& exist_row, const TensorView& loc_col, const TensorView& exist_col);
 
 private:
+    int32_t Warmup(int32_t num_warmup);
+    void ArgMaxGrid(const TensorView& v, std::vector<int32_t>& max_index_list);
+    void DecodeLane(std::vector<Line<float>>& line_list, const TensorView& loc, const std::vector<int32_t>& valid, uint32_t lane_mask, int32_t threshold_valid_num, bool is_row_anchor);
 
 private:
     std::unique_ptr<InferenceHelper> inference_helper_;
     std::vector<InputTensorInfo> input_tensor_info_list_;
     std::vector<OutputTensorInfo> output_tensor_info_list_;
+    bool is_rgb_;
 
     std::vector<float> row_anchor_;
     std::vector<float> col_anchor_;
 
+    /* work buffers reused for each frame to avoid allocation */
+    std::vector<float> max_val_buffer_;
+    std::vector<int32_t> max_indices_;
+    std::vector<int32_t> valid_row_;
+    std::vector<int32_t> valid_col_;
+    std::vector<int32_t> valid_num_;
+
+    uint32_t lane_mask_row_;
+    uint32_t lane_mask_col_;
+
 };
 
 #endif
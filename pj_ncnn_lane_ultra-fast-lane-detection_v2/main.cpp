@@ -43,6 +43,8 @@ int32_t main(int argc, char* argv[])
     double total_time_pre_process = 0;
     double total_time_inference = 0;
     double total_time_post_process = 0;
+    double first_time_image_process = 0;
+    double first_time_inference = 0;
 
     /* Find source image */
     std::string input_name = (argc > 1) ? argv[1] : DEFAULT_INPUT_IMAGE;
@@ -56,7 +58,7 @@ int32_t main(int argc, char* argv[])
     // writer = cv::VideoWriter("out.mp4", cv::VideoWriter::fourcc('M', 'P', '4', 'V'), (std::max)(10.0, cap.get(cv::CAP_PROP_FPS)), cv::Size(static_cast<int32_t>(cap.get(cv::CAP_PROP_FRAME_WIDTH)), static_cast<int32_t>(cap.get(cv::CAP_PROP_FRAME_HEIGHT))));
 
     /* Initialize image processor library */
-    ImageProcessor::InputParam input_param = { WORK_DIR, 4 };
+    ImageProcessor::InputParam input_param = { WORK_DIR, 4, 2 };
     if (ImageProcessor::Initialize(input_param) != 0) {
         printf("Initialization Error\n");
         return -1;
@@ -107,7 +109,10 @@ int32_t main(int argc, char* argv[])
         printf("    Post processing: %9.3lf [msec]\n", result.time_post_process);
         printf("=== Finished %d frame ===\n\n", frame_cnt);
 
-        if (frame_cnt > 0) {    /* do not count the first process because it may include initialize process */
+        if (frame_cnt == 0) {   /* the first process is reported separately as cold start */
+            first_time_image_process = time_image_process;
+            first_time_inference = result.time_inference;
+        } else {
             total_time_all += time_all;
             total_time_cap += time_cap;
             total_time_image_process += time_image_process;
@@ -119,9 +124,14 @@ int32_t main(int argc, char* argv[])
     
     /*** Finalize ***/
     /* Print average processing time */
+    if (frame_cnt > 0) {
+        printf("=== First frame (cold start) ===\n");
+        printf("  Image processing:  %9.3lf [msec]\n", first_time_image_process);
+        printf("    Inference:       %9.3lf [msec]\n", first_time_inference);
+    }
     if (frame_cnt > 1) {
         frame_cnt--;    /* because the first process was not counted */
-        printf("=== Average processing time ===\n");
+        printf("=== Average processing time (steady state) ===\n");
         printf("Total:               %9.3lf [msec]\n", total_time_all / frame_cnt);
         printf("  Capture:           %9.3lf [msec]\n", total_time_cap / frame_cnt);
         printf("  Image processing:  %9.3lf [msec]\n", total_time_image_process / frame_cnt);